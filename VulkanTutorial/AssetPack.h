@@ -0,0 +1,204 @@
+#pragma once
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <stdexcept>
+#include <algorithm>
+#include <string>
+#include <cstring>
+#include <cstdint>
+
+const uint32_t ASSET_PACK_MAGIC = 0x50415456; // "VTAP"
+const uint32_t ASSET_PACK_VERSION = 1;
+const uint64_t ASSET_PACK_ALIGNMENT = 256;
+const size_t ASSET_NAME_SIZE = 112;
+
+// On-disk layout: header, entry table sorted by name, then payloads, each
+// starting on an ASSET_PACK_ALIGNMENT boundary. The alignment keeps SPIR-V
+// word aligned and lets payloads be copied to staging memory in whole cache
+// lines.
+struct AssetPackHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t reserved;
+};
+
+struct AssetPackEntry {
+	char name[ASSET_NAME_SIZE];
+	uint64_t offset;
+	uint64_t size;
+};
+
+struct AssetView {
+	const void* data = nullptr;
+	size_t size = 0;
+};
+
+// Read-only memory mapping of an asset pack. Views point straight into the
+// mapping and stay valid until close().
+class AssetPack {
+public:
+	// Returns false when the file does not exist; throws when it is not a valid pack.
+	bool open(const std::string& path) {
+		if (!map(path)) {
+			return false;
+		}
+
+		AssetPackHeader header;
+		if (mappedSize < sizeof(header)) {
+			close();
+			throw std::runtime_error("truncated asset pack " + path + "!");
+		}
+		memcpy(&header, mapped, sizeof(header));
+
+		if (header.magic != ASSET_PACK_MAGIC || header.version != ASSET_PACK_VERSION) {
+			close();
+			throw std::runtime_error(path + " is not a supported asset pack!");
+		}
+
+		entries = reinterpret_cast<const AssetPackEntry*>(static_cast<const char*>(mapped) + sizeof(header));
+		entryCount = header.entryCount;
+
+		if (sizeof(header) + sizeof(AssetPackEntry) * entryCount > mappedSize) {
+			close();
+			throw std::runtime_error("truncated asset pack " + path + "!");
+		}
+
+		for (uint32_t i = 0; i < entryCount; i++) {
+			if (entries[i].offset > mappedSize || entries[i].size > mappedSize - entries[i].offset) {
+				close();
+				throw std::runtime_error("truncated asset pack " + path + "!");
+			}
+		}
+
+		return true;
+	}
+
+	void close() {
+		unmap();
+		entries = nullptr;
+		entryCount = 0;
+	}
+
+	bool isOpen() const {
+		return mapped != nullptr;
+	}
+
+	bool find(const std::string& name, AssetView& view) const {
+		if (entries == nullptr || name.size() >= ASSET_NAME_SIZE) {
+			return false;
+		}
+
+		const AssetPackEntry* end = entries + entryCount;
+		const AssetPackEntry* entry = std::lower_bound(entries, end, name, [](const AssetPackEntry& e, const std::string& n) {
+			return strncmp(e.name, n.c_str(), ASSET_NAME_SIZE) < 0;
+		});
+
+		if (entry == end || strncmp(entry->name, name.c_str(), ASSET_NAME_SIZE) != 0) {
+			return false;
+		}
+
+		view.data = static_cast<const char*>(mapped) + entry->offset;
+		view.size = static_cast<size_t>(entry->size);
+		return true;
+	}
+
+	bool contains(const std::string& name) const {
+		AssetView view;
+		return find(name, view);
+	}
+
+private:
+	const void* mapped = nullptr;
+	size_t mappedSize = 0;
+	const AssetPackEntry* entries = nullptr;
+	uint32_t entryCount = 0;
+
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+
+	bool map(const std::string& path) {
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+
+		LARGE_INTEGER fileSize;
+		GetFileSizeEx(file, &fileSize);
+		mappedSize = static_cast<size_t>(fileSize.QuadPart);
+
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		mapped = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		if (mapped == nullptr) {
+			unmap();
+			throw std::runtime_error("failed to map asset pack " + path + "!");
+		}
+
+		return true;
+	}
+
+	void unmap() {
+		if (mapped != nullptr) {
+			UnmapViewOfFile(mapped);
+			mapped = nullptr;
+		}
+		if (mapping != nullptr) {
+			CloseHandle(mapping);
+			mapping = nullptr;
+		}
+		if (file != INVALID_HANDLE_VALUE) {
+			CloseHandle(file);
+			file = INVALID_HANDLE_VALUE;
+		}
+		mappedSize = 0;
+	}
+#else
+	bool map(const std::string& path) {
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+
+		struct stat fileInfo;
+		if (fstat(fd, &fileInfo) != 0) {
+			::close(fd);
+			throw std::runtime_error("failed to map asset pack " + path + "!");
+		}
+		mappedSize = static_cast<size_t>(fileInfo.st_size);
+
+		void* address = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+
+		if (address == MAP_FAILED) {
+			mappedSize = 0;
+			throw std::runtime_error("failed to map asset pack " + path + "!");
+		}
+
+		mapped = address;
+		return true;
+	}
+
+	void unmap() {
+		if (mapped != nullptr) {
+			munmap(const_cast<void*>(mapped), mappedSize);
+			mapped = nullptr;
+		}
+		mappedSize = 0;
+	}
+#endif
+};
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <vector>
+#include <cstdint>
+
+const uint32_t BINDLESS_MAX_TEXTURES = 4096;
+const uint32_t BINDLESS_MAX_BUFFERS = 1024;
+
+const uint32_t BINDLESS_TEXTURE_BINDING = 0;
+const uint32_t BINDLESS_BUFFER_BINDING = 1;
+
+// Hands out slot indices below a fixed capacity. A freed slot is reused by the
+// next allocation, so it must only be freed once no frame in flight reads it.
+class HandleAllocator {
+public:
+	void init(uint32_t capacity) {
+		this->capacity = capacity;
+		next = 0;
+		freeHandles.clear();
+	}
+
+	uint32_t allocate() {
+		if (!freeHandles.empty()) {
+			uint32_t handle = freeHandles.back();
+			freeHandles.pop_back();
+			return handle;
+		}
+
+		if (next == capacity) {
+			throw std::runtime_error("out of bindless handles!");
+		}
+
+		return next++;
+	}
+
+	void free(uint32_t handle) {
+		freeHandles.push_back(handle);
+	}
+
+	uint32_t getCapacity() const {
+		return capacity;
+	}
+
+	uint32_t getUsedCount() const {
+		return next - static_cast<uint32_t>(freeHandles.size());
+	}
+
+private:
+	uint32_t capacity = 0;
+	uint32_t next = 0;
+	std::vector<uint32_t> freeHandles;
+};
+
+// One descriptor set holding every texture and storage buffer the renderer uses,
+// in two large partially bound arrays that are written as resources come and
+// go. It is bound once per command buffer and shaders pick entries by the
+// handle they are given, so adding a resource never means a new set or bind.
+// Slots that are free or retired are left pointing at whatever they held last;
+// partial binding makes that legal as long as no shader reads them.
+class BindlessTable {
+public:
+	void init(VkPhysicalDevice physicalDevice, VkDevice device) {
+		this->device = device;
+
+		VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+		indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+		VkPhysicalDeviceProperties2 properties{};
+		properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties.pNext = &indexingProperties;
+		vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+		uint32_t textureCapacity = std::min({ BINDLESS_MAX_TEXTURES,
+			indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages, indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+			indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages, indexingProperties.maxDescriptorSetUpdateAfterBindSamplers });
+		uint32_t bufferCapacity = std::min({ BINDLESS_MAX_BUFFERS,
+			indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers, indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers });
+
+		textureHandles.init(textureCapacity);
+		bufferHandles.init(bufferCapacity);
+
+		std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+		bindings[BINDLESS_TEXTURE_BINDING].binding = BINDLESS_TEXTURE_BINDING;
+		bindings[BINDLESS_TEXTURE_BINDING].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		bindings[BINDLESS_TEXTURE_BINDING].descriptorCount = textureCapacity;
+		bindings[BINDLESS_TEXTURE_BINDING].stageFlags = VK_SHADER_STAGE_ALL;
+		bindings[BINDLESS_BUFFER_BINDING].binding = BINDLESS_BUFFER_BINDING;
+		bindings[BINDLESS_BUFFER_BINDING].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[BINDLESS_BUFFER_BINDING].descriptorCount = bufferCapacity;
+		bindings[BINDLESS_BUFFER_BINDING].stageFlags = VK_SHADER_STAGE_ALL;
+
+		VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+			VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+		std::array<VkDescriptorBindingFlags, 2> flags = { bindingFlags, bindingFlags };
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+		flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+		flagsInfo.bindingCount = static_cast<uint32_t>(flags.size());
+		flagsInfo.pBindingFlags = flags.data();
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.pNext = &flagsInfo;
+		layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+		layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+		layoutInfo.pBindings = bindings.data();
+
+		if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create bindless descriptor set layout!");
+		}
+
+		std::array<VkDescriptorPoolSize, 2> poolSizes{};
+		poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		poolSizes[0].descriptorCount = textureCapacity;
+		poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSizes[1].descriptorCount = bufferCapacity;
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+		poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+		poolInfo.pPoolSizes = poolSizes.data();
+		poolInfo.maxSets = 1;
+
+		if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create bindless descriptor pool!");
+		}
+
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = pool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &layout;
+
+		if (vkAllocateDescriptorSets(device, &allocInfo, &set) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate bindless descriptor set!");
+		}
+	}
+
+	void cleanup() {
+		vkDestroyDescriptorPool(device, pool, nullptr);
+		vkDestroyDescriptorSetLayout(device, layout, nullptr);
+	}
+
+	uint32_t addTexture(VkImageView imageView, VkSampler sampler) {
+		uint32_t handle = textureHandles.allocate();
+
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.sampler = sampler;
+		imageInfo.imageView = imageView;
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkWriteDescriptorSet descriptorWrite{};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = set;
+		descriptorWrite.dstBinding = BINDLESS_TEXTURE_BINDING;
+		descriptorWrite.dstArrayElement = handle;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.pImageInfo = &imageInfo;
+
+		vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+		return handle;
+	}
+
+	uint32_t addBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE) {
+		uint32_t handle = bufferHandles.allocate();
+
+		VkDescriptorBufferInfo bufferInfo{};
+		bufferInfo.buffer = buffer;
+		bufferInfo.offset = offset;
+		bufferInfo.range = range;
+
+		VkWriteDescriptorSet descriptorWrite{};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = set;
+		descriptorWrite.dstBinding = BINDLESS_BUFFER_BINDING;
+		descriptorWrite.dstArrayElement = handle;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.pBufferInfo = &bufferInfo;
+
+		vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+		return handle;
+	}
+
+	// Slots are reused straight away; defer removal through the deletion queue
+	// while frames that read the slot may still be in flight.
+	void removeTexture(uint32_t handle) {
+		textureHandles.free(handle);
+	}
+
+	void removeBuffer(uint32_t handle) {
+		bufferHandles.free(handle);
+	}
+
+	VkDescriptorSetLayout getLayout() const {
+		return layout;
+	}
+
+	VkDescriptorSet getSet() const {
+		return set;
+	}
+
+	const HandleAllocator& getTextureHandles() const {
+		return textureHandles;
+	}
+
+	const HandleAllocator& getBufferHandles() const {
+		return bufferHandles;
+	}
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	VkDescriptorSet set = VK_NULL_HANDLE;
+
+	HandleAllocator textureHandles;
+	HandleAllocator bufferHandles;
+};
@@ -0,0 +1,294 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <stdexcept>
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+struct Ktx2Header {
+	uint8_t identifier[12];
+	uint32_t vkFormat;
+	uint32_t typeSize;
+	uint32_t pixelWidth;
+	uint32_t pixelHeight;
+	uint32_t pixelDepth;
+	uint32_t layerCount;
+	uint32_t faceCount;
+	uint32_t levelCount;
+	uint32_t supercompressionScheme;
+	uint32_t dfdByteOffset;
+	uint32_t dfdByteLength;
+	uint32_t kvdByteOffset;
+	uint32_t kvdByteLength;
+	uint64_t sgdByteOffset;
+	uint64_t sgdByteLength;
+};
+
+struct Ktx2LevelIndex {
+	uint64_t byteOffset;
+	uint64_t byteLength;
+	uint64_t uncompressedByteLength;
+};
+
+const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+const uint32_t DDS_FOURCC_DXT1 = 0x31545844;
+const uint32_t DDS_FOURCC_DXT5 = 0x35545844;
+const uint32_t DDS_FOURCC_DX10 = 0x30315844;
+const uint32_t DDS_FLAG_MIPMAPCOUNT = 0x20000;
+
+const uint32_t DXGI_FORMAT_BC1_UNORM = 71;
+const uint32_t DXGI_FORMAT_BC1_UNORM_SRGB = 72;
+const uint32_t DXGI_FORMAT_BC3_UNORM = 77;
+const uint32_t DXGI_FORMAT_BC3_UNORM_SRGB = 78;
+const uint32_t DXGI_FORMAT_BC7_UNORM = 98;
+const uint32_t DXGI_FORMAT_BC7_UNORM_SRGB = 99;
+
+struct DdsPixelFormat {
+	uint32_t size;
+	uint32_t flags;
+	uint32_t fourCC;
+	uint32_t rgbBitCount;
+	uint32_t rBitMask;
+	uint32_t gBitMask;
+	uint32_t bBitMask;
+	uint32_t aBitMask;
+};
+
+struct DdsHeader {
+	uint32_t size;
+	uint32_t flags;
+	uint32_t height;
+	uint32_t width;
+	uint32_t pitchOrLinearSize;
+	uint32_t depth;
+	uint32_t mipMapCount;
+	uint32_t reserved1[11];
+	DdsPixelFormat pixelFormat;
+	uint32_t caps[4];
+	uint32_t reserved2;
+};
+
+struct DdsHeaderDx10 {
+	uint32_t dxgiFormat;
+	uint32_t resourceDimension;
+	uint32_t miscFlag;
+	uint32_t arraySize;
+	uint32_t miscFlags2;
+};
+
+// Bytes per 4x4 block, or 0 for formats this loader does not handle.
+inline uint32_t getBlockSize(VkFormat format) {
+	switch (format) {
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		return 8;
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+inline VkDeviceSize getCompressedLevelSize(VkFormat format, uint32_t width, uint32_t height) {
+	return static_cast<VkDeviceSize>((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(format);
+}
+
+struct CompressedMipLevel {
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	uint32_t width;
+	uint32_t height;
+};
+
+// Block-compressed 2D texture. Level offsets are relative to getData(), which
+// is either the file contents held in storage or memory owned by someone else,
+// such as an asset pack mapping, that must outlive the texture.
+struct CompressedTexture {
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<CompressedMipLevel> levels;
+	std::vector<char> storage;
+	const char* external = nullptr;
+
+	const char* getData() const {
+		return external != nullptr ? external : storage.data();
+	}
+
+	VkDeviceSize getDataSize() const {
+		VkDeviceSize size = 0;
+		for (const auto& level : levels) {
+			size += level.size;
+		}
+		return size;
+	}
+};
+
+inline std::vector<char> readTextureFile(const std::string& filename) {
+	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+	if (!file.is_open()) {
+		throw std::runtime_error("failed to open texture file " + filename + "!");
+	}
+
+	size_t fileSize = (size_t)file.tellg();
+	std::vector<char> buffer(fileSize);
+
+	file.seekg(0);
+	file.read(buffer.data(), fileSize);
+
+	return buffer;
+}
+
+inline CompressedTexture parseKtx2(const char* data, size_t size, const std::string& name) {
+	Ktx2Header header;
+	if (size < sizeof(header)) {
+		throw std::runtime_error("truncated KTX2 file " + name + "!");
+	}
+	memcpy(&header, data, sizeof(header));
+
+	if (memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+		throw std::runtime_error(name + " is not a KTX2 file!");
+	}
+	if (header.supercompressionScheme != 0 || header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1) {
+		throw std::runtime_error(name + " uses KTX2 features this loader does not support!");
+	}
+
+	CompressedTexture texture;
+	texture.format = static_cast<VkFormat>(header.vkFormat);
+	texture.width = header.pixelWidth;
+	texture.height = header.pixelHeight;
+	texture.external = data;
+
+	if (getBlockSize(texture.format) == 0) {
+		throw std::runtime_error(name + " is not BC1, BC3 or BC7 compressed!");
+	}
+
+	uint32_t levelCount = std::max(header.levelCount, 1u);
+	if (size < sizeof(header) + sizeof(Ktx2LevelIndex) * levelCount) {
+		throw std::runtime_error("truncated KTX2 file " + name + "!");
+	}
+
+	for (uint32_t level = 0; level < levelCount; level++) {
+		Ktx2LevelIndex index;
+		memcpy(&index, data + sizeof(header) + sizeof(Ktx2LevelIndex) * level, sizeof(index));
+
+		if (index.byteOffset + index.byteLength > size) {
+			throw std::runtime_error("truncated KTX2 file " + name + "!");
+		}
+
+		CompressedMipLevel mip{};
+		mip.offset = index.byteOffset;
+		mip.size = index.byteLength;
+		mip.width = std::max(texture.width >> level, 1u);
+		mip.height = std::max(texture.height >> level, 1u);
+		texture.levels.push_back(mip);
+	}
+
+	return texture;
+}
+
+inline CompressedTexture loadKtx2(const std::string& filename) {
+	std::vector<char> file = readTextureFile(filename);
+
+	CompressedTexture texture = parseKtx2(file.data(), file.size(), filename);
+	texture.external = nullptr;
+	texture.storage = std::move(file);
+	return texture;
+}
+
+inline CompressedTexture loadDds(const std::string& filename) {
+	std::vector<char> file = readTextureFile(filename);
+
+	uint32_t magic;
+	DdsHeader header;
+	if (file.size() < sizeof(magic) + sizeof(header)) {
+		throw std::runtime_error("truncated DDS file " + filename + "!");
+	}
+	memcpy(&magic, file.data(), sizeof(magic));
+	memcpy(&header, file.data() + sizeof(magic), sizeof(header));
+
+	if (magic != DDS_MAGIC) {
+		throw std::runtime_error(filename + " is not a DDS file!");
+	}
+
+	size_t dataOffset = sizeof(magic) + sizeof(header);
+
+	CompressedTexture texture;
+	texture.width = header.width;
+	texture.height = header.height;
+
+	if (header.pixelFormat.fourCC == DDS_FOURCC_DXT1) {
+		texture.format = VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+	}
+	else if (header.pixelFormat.fourCC == DDS_FOURCC_DXT5) {
+		texture.format = VK_FORMAT_BC3_UNORM_BLOCK;
+	}
+	else if (header.pixelFormat.fourCC == DDS_FOURCC_DX10) {
+		DdsHeaderDx10 dx10Header;
+		if (file.size() < dataOffset + sizeof(dx10Header)) {
+			throw std::runtime_error("truncated DDS file " + filename + "!");
+		}
+		memcpy(&dx10Header, file.data() + dataOffset, sizeof(dx10Header));
+		dataOffset += sizeof(dx10Header);
+
+		switch (dx10Header.dxgiFormat) {
+		case DXGI_FORMAT_BC1_UNORM: texture.format = VK_FORMAT_BC1_RGBA_UNORM_BLOCK; break;
+		case DXGI_FORMAT_BC1_UNORM_SRGB: texture.format = VK_FORMAT_BC1_RGBA_SRGB_BLOCK; break;
+		case DXGI_FORMAT_BC3_UNORM: texture.format = VK_FORMAT_BC3_UNORM_BLOCK; break;
+		case DXGI_FORMAT_BC3_UNORM_SRGB: texture.format = VK_FORMAT_BC3_SRGB_BLOCK; break;
+		case DXGI_FORMAT_BC7_UNORM: texture.format = VK_FORMAT_BC7_UNORM_BLOCK; break;
+		case DXGI_FORMAT_BC7_UNORM_SRGB: texture.format = VK_FORMAT_BC7_SRGB_BLOCK; break;
+		default: break;
+		}
+	}
+
+	if (getBlockSize(texture.format) == 0) {
+		throw std::runtime_error(filename + " is not BC1, BC3 or BC7 compressed!");
+	}
+
+	uint32_t levelCount = (header.flags & DDS_FLAG_MIPMAPCOUNT) ? std::max(header.mipMapCount, 1u) : 1;
+
+	VkDeviceSize totalSize = 0;
+	for (uint32_t level = 0; level < levelCount; level++) {
+		CompressedMipLevel mip{};
+		mip.offset = totalSize;
+		mip.width = std::max(texture.width >> level, 1u);
+		mip.height = std::max(texture.height >> level, 1u);
+		mip.size = getCompressedLevelSize(texture.format, mip.width, mip.height);
+		texture.levels.push_back(mip);
+
+		totalSize += mip.size;
+	}
+
+	if (file.size() < dataOffset + totalSize) {
+		throw std::runtime_error("truncated DDS file " + filename + "!");
+	}
+
+	for (auto& level : texture.levels) {
+		level.offset += dataOffset;
+	}
+
+	texture.storage = std::move(file);
+	return texture;
+}
+
+inline CompressedTexture loadCompressedTexture(const std::string& filename) {
+	std::string extension = filename.substr(filename.find_last_of('.') + 1);
+	if (extension == "dds" || extension == "DDS") {
+		return loadDds(filename);
+	}
+	return loadKtx2(filename);
+}
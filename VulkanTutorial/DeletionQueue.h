@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
+#include <utility>
+#include <vector>
+#include <cstdint>
+
+#include "MemoryAllocator.h"
+
+// Destroys objects released at runtime once the GPU is done with them. Each
+// entry is tagged with a frame timeline value, normally the last frame
+// submitted that could still use the object, and runs when flush() is given a
+// completed value at or past it. Entries with the same value run in the order
+// they were pushed, so dependent objects (a framebuffer and its image views)
+// should be pushed before what they depend on.
+class DeletionQueue {
+public:
+	void init(VkDevice device, DeviceMemoryAllocator* memoryAllocator) {
+		this->device = device;
+		this->memoryAllocator = memoryAllocator;
+	}
+
+	void push(uint64_t value, std::function<void()> deleter) {
+		entries.push_back({ value, std::move(deleter) });
+	}
+
+	void destroyBuffer(uint64_t value, VkBuffer buffer, Allocation allocation) {
+		push(value, [this, buffer, allocation]() mutable {
+			vkDestroyBuffer(device, buffer, nullptr);
+			memoryAllocator->free(allocation);
+		});
+	}
+
+	void destroyImage(uint64_t value, VkImage image, Allocation allocation) {
+		push(value, [this, image, allocation]() mutable {
+			vkDestroyImage(device, image, nullptr);
+			memoryAllocator->free(allocation);
+		});
+	}
+
+	void destroyImageView(uint64_t value, VkImageView imageView) {
+		push(value, [this, imageView]() {
+			vkDestroyImageView(device, imageView, nullptr);
+		});
+	}
+
+	void destroyFramebuffer(uint64_t value, VkFramebuffer framebuffer) {
+		push(value, [this, framebuffer]() {
+			vkDestroyFramebuffer(device, framebuffer, nullptr);
+		});
+	}
+
+	void destroyPipeline(uint64_t value, VkPipeline pipeline) {
+		push(value, [this, pipeline]() {
+			vkDestroyPipeline(device, pipeline, nullptr);
+		});
+	}
+
+	void destroySwapchain(uint64_t value, VkSwapchainKHR swapChain) {
+		push(value, [this, swapChain]() {
+			vkDestroySwapchainKHR(device, swapChain, nullptr);
+		});
+	}
+
+	void freeMemory(uint64_t value, Allocation allocation) {
+		push(value, [this, allocation]() mutable {
+			memoryAllocator->free(allocation);
+		});
+	}
+
+	// Values need not arrive in order, so every entry is checked.
+	void flush(uint64_t completedValue) {
+		if (entries.empty()) {
+			return;
+		}
+
+		std::vector<Entry> pending;
+		for (Entry& entry : entries) {
+			if (entry.value <= completedValue) {
+				entry.deleter();
+			}
+			else {
+				pending.push_back(std::move(entry));
+			}
+		}
+
+		entries = std::move(pending);
+	}
+
+	// Only once the device is idle.
+	void flushAll() {
+		for (Entry& entry : entries) {
+			entry.deleter();
+		}
+
+		entries.clear();
+	}
+
+	size_t size() const {
+		return entries.size();
+	}
+
+private:
+	struct Entry {
+		uint64_t value;
+		std::function<void()> deleter;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	DeviceMemoryAllocator* memoryAllocator = nullptr;
+	std::vector<Entry> entries;
+};
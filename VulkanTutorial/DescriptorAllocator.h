@@ -0,0 +1,280 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+const uint32_t DESCRIPTOR_POOL_MAX_SETS = 4096;
+
+// Descriptors of one type reserved per set, used to size every pool the
+// allocator creates.
+struct DescriptorPoolRatio {
+	VkDescriptorType type;
+	float ratio;
+};
+
+// Hands out descriptor sets from a chain of pools. When the current pool runs
+// out another is created, each twice the size of the last up to
+// DESCRIPTOR_POOL_MAX_SETS, so allocation never fails just because the initial
+// estimate was low. Sets are never freed individually; reset() returns every
+// pool to the allocator at once.
+class DescriptorAllocator {
+public:
+	void init(VkDevice device, uint32_t initialSets, const std::vector<DescriptorPoolRatio>& ratios) {
+		this->device = device;
+		this->ratios = ratios;
+		setsPerPool = initialSets;
+
+		readyPools.push_back(createPool(setsPerPool));
+	}
+
+	void cleanup() {
+		for (VkDescriptorPool pool : readyPools) {
+			vkDestroyDescriptorPool(device, pool, nullptr);
+		}
+		for (VkDescriptorPool pool : fullPools) {
+			vkDestroyDescriptorPool(device, pool, nullptr);
+		}
+
+		readyPools.clear();
+		fullPools.clear();
+	}
+
+	VkDescriptorSet allocate(VkDescriptorSetLayout layout) {
+		VkDescriptorPool pool = getPool();
+
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = pool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &layout;
+
+		VkDescriptorSet set;
+		VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+		if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+			fullPools.push_back(pool);
+			readyPools.pop_back();
+
+			allocInfo.descriptorPool = getPool();
+			result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+		}
+
+		if (result != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate descriptor set!");
+		}
+
+		allocatedSets++;
+		return set;
+	}
+
+	// Every set allocated since the last reset must be out of use on the GPU.
+	void reset() {
+		for (VkDescriptorPool pool : fullPools) {
+			readyPools.push_back(pool);
+		}
+		fullPools.clear();
+
+		for (VkDescriptorPool pool : readyPools) {
+			vkResetDescriptorPool(device, pool, 0);
+		}
+
+		allocatedSets = 0;
+	}
+
+	VkDevice getDevice() const {
+		return device;
+	}
+
+	size_t getPoolCount() const {
+		return readyPools.size() + fullPools.size();
+	}
+
+	uint32_t getAllocatedSetCount() const {
+		return allocatedSets;
+	}
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	std::vector<DescriptorPoolRatio> ratios;
+	uint32_t setsPerPool = 0;
+	uint32_t allocatedSets = 0;
+
+	std::vector<VkDescriptorPool> readyPools;
+	std::vector<VkDescriptorPool> fullPools;
+
+	VkDescriptorPool getPool() {
+		if (!readyPools.empty()) {
+			return readyPools.back();
+		}
+
+		setsPerPool = std::min(setsPerPool * 2, DESCRIPTOR_POOL_MAX_SETS);
+		readyPools.push_back(createPool(setsPerPool));
+		return readyPools.back();
+	}
+
+	VkDescriptorPool createPool(uint32_t setCount) {
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		for (const DescriptorPoolRatio& ratio : ratios) {
+			poolSizes.push_back({ ratio.type, std::max(1u, static_cast<uint32_t>(ratio.ratio * setCount)) });
+		}
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+		poolInfo.pPoolSizes = poolSizes.data();
+		poolInfo.maxSets = setCount;
+
+		VkDescriptorPool pool;
+		if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create descriptor pool!");
+		}
+
+		return pool;
+	}
+};
+
+// What one binding of a set points at. Only the fields that apply to the
+// descriptor type are read, but all of them take part in the cache key, so
+// leave the rest zeroed.
+struct DescriptorBinding {
+	VkDescriptorType type;
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize range = 0;
+	VkImageView imageView = VK_NULL_HANDLE;
+	VkSampler sampler = VK_NULL_HANDLE;
+	VkImageLayout imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	bool operator==(const DescriptorBinding& other) const {
+		return type == other.type && buffer == other.buffer && offset == other.offset && range == other.range &&
+			imageView == other.imageView && sampler == other.sampler && imageLayout == other.imageLayout;
+	}
+};
+
+inline DescriptorBinding bufferBinding(VkDescriptorType type, VkBuffer buffer, VkDeviceSize range, VkDeviceSize offset = 0) {
+	DescriptorBinding binding{};
+	binding.type = type;
+	binding.buffer = buffer;
+	binding.offset = offset;
+	binding.range = range;
+	return binding;
+}
+
+// Returns a set for a layout and a list of bindings (binding i describes
+// binding number i), allocating and writing it only the first time that
+// combination is asked for. Cached sets live in the allocator's pools, so
+// clear() must go together with the allocator's reset(). Safe to call from
+// several recording threads at once.
+class DescriptorSetCache {
+public:
+	void init(DescriptorAllocator* allocator) {
+		this->allocator = allocator;
+	}
+
+	VkDescriptorSet get(VkDescriptorSetLayout layout, const std::vector<DescriptorBinding>& bindings) {
+		std::lock_guard<std::mutex> lock(*mutex);
+
+		Key key{ layout, bindings };
+		auto it = sets.find(key);
+		if (it != sets.end()) {
+			hits++;
+			return it->second;
+		}
+
+		VkDescriptorSet set = allocator->allocate(layout);
+		write(set, bindings);
+
+		sets.emplace(std::move(key), set);
+		misses++;
+		return set;
+	}
+
+	void clear() {
+		std::lock_guard<std::mutex> lock(*mutex);
+		sets.clear();
+	}
+
+	uint64_t getHits() const {
+		return hits;
+	}
+
+	uint64_t getMisses() const {
+		return misses;
+	}
+
+private:
+	struct Key {
+		VkDescriptorSetLayout layout;
+		std::vector<DescriptorBinding> bindings;
+
+		bool operator==(const Key& other) const {
+			return layout == other.layout && bindings == other.bindings;
+		}
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key& key) const {
+			size_t hash = std::hash<VkDescriptorSetLayout>()(key.layout);
+			for (const DescriptorBinding& binding : key.bindings) {
+				combine(hash, binding.type);
+				combine(hash, binding.buffer);
+				combine(hash, binding.offset);
+				combine(hash, binding.range);
+				combine(hash, binding.imageView);
+				combine(hash, binding.sampler);
+				combine(hash, binding.imageLayout);
+			}
+			return hash;
+		}
+
+		template <typename T>
+		static void combine(size_t& hash, const T& value) {
+			hash ^= std::hash<T>()(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+		}
+	};
+
+	DescriptorAllocator* allocator = nullptr;
+	std::unique_ptr<std::mutex> mutex = std::make_unique<std::mutex>();
+	std::unordered_map<Key, VkDescriptorSet, KeyHash> sets;
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+
+	void write(VkDescriptorSet set, const std::vector<DescriptorBinding>& bindings) {
+		std::vector<VkDescriptorBufferInfo> bufferInfos(bindings.size());
+		std::vector<VkDescriptorImageInfo> imageInfos(bindings.size());
+		std::vector<VkWriteDescriptorSet> descriptorWrites(bindings.size());
+
+		for (uint32_t i = 0; i < bindings.size(); i++) {
+			const DescriptorBinding& binding = bindings[i];
+
+			descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[i].dstSet = set;
+			descriptorWrites[i].dstBinding = i;
+			descriptorWrites[i].dstArrayElement = 0;
+			descriptorWrites[i].descriptorType = binding.type;
+			descriptorWrites[i].descriptorCount = 1;
+
+			if (binding.imageView != VK_NULL_HANDLE || binding.sampler != VK_NULL_HANDLE) {
+				imageInfos[i].imageView = binding.imageView;
+				imageInfos[i].sampler = binding.sampler;
+				imageInfos[i].imageLayout = binding.imageLayout;
+				descriptorWrites[i].pImageInfo = &imageInfos[i];
+			}
+			else {
+				bufferInfos[i].buffer = binding.buffer;
+				bufferInfos[i].offset = binding.offset;
+				bufferInfos[i].range = binding.range;
+				descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+			}
+		}
+
+		vkUpdateDescriptorSets(allocator->getDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+};
@@ -0,0 +1,568 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <stb_image_write.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+#include "MemoryAllocator.h"
+
+enum class FrameFormat {
+	Discard,
+	Raw,
+	Y4m,
+	Png
+};
+
+inline FrameFormat parseFrameFormat(const std::string& name) {
+	if (name == "raw") {
+		return FrameFormat::Raw;
+	}
+	if (name == "y4m") {
+		return FrameFormat::Y4m;
+	}
+	if (name == "png") {
+		return FrameFormat::Png;
+	}
+	throw std::runtime_error("unknown frame format: " + name);
+}
+
+// Picks the format from the output path, so "--output frames.png" needs no
+// separate format flag. Anything unrecognised, including pipes, gets raw RGBA.
+inline FrameFormat guessFrameFormat(const std::string& path) {
+	if (path.empty()) {
+		return FrameFormat::Discard;
+	}
+
+	std::string extension = path.substr(std::min(path.find_last_of('.'), path.size()));
+	if (extension == ".png") {
+		return FrameFormat::Png;
+	}
+	if (extension == ".y4m") {
+		return FrameFormat::Y4m;
+	}
+	return FrameFormat::Raw;
+}
+
+struct FrameReadbackStats {
+	uint64_t captured = 0;
+	uint64_t dropped = 0;
+	uint64_t written = 0;
+	uint64_t bytesWritten = 0;
+	double writeSeconds = 0.0;
+};
+
+// Copies rendered frames into a ring of persistently mapped host buffers and
+// hands them to a writer thread that encodes them to disk or a pipe. The render
+// thread never waits on it: record() drops the frame when every slot is still
+// in flight or queued, and collect() only moves slots whose frames the caller
+// already knows are complete (from the frame timeline).
+//
+// Paths starting with '|' are run as a command that receives the stream on its
+// stdin. PNG writes one file per frame; a single integer conversion in the path
+// ("%05llu", "%d") sets the numbering, otherwise the frame number is appended
+// to the name. Any other '%' in a PNG path is rejected.
+class FrameReadback {
+public:
+	void init(VkPhysicalDevice physicalDevice, VkDevice device, DeviceMemoryAllocator* allocator, VkExtent2D extent, uint32_t slotCount,
+		const std::string& path, FrameFormat format, uint32_t frameRate) {
+		this->device = device;
+		this->allocator = allocator;
+		this->extent = extent;
+		this->path = path;
+		this->format = format;
+
+		if (format != FrameFormat::Discard && path.empty()) {
+			throw std::runtime_error("frame output format needs an output path!");
+		}
+
+		if (format == FrameFormat::Png) {
+			parseFramePattern();
+		}
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+		openOutput(frameRate);
+
+		frameSize = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+		slots.resize(std::max(slotCount, 1u));
+		for (uint32_t i = 0; i < slots.size(); i++) {
+			createSlot(slots[i], properties.limits.nonCoherentAtomSize);
+			freeSlots.push_back(i);
+		}
+
+		stopping = false;
+		writer = std::thread([this]() { writerLoop(); });
+	}
+
+	void cleanup() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		slotQueued.notify_all();
+		writer.join();
+
+		for (auto& slot : slots) {
+			vkDestroyBuffer(device, slot.buffer, nullptr);
+			allocator->free(slot.allocation);
+		}
+		slots.clear();
+		freeSlots.clear();
+		pendingSlots.clear();
+
+		closeOutput();
+	}
+
+	// Records the copy of image, which must be in TRANSFER_SRC_OPTIMAL, into a
+	// free slot. Returns false and counts a dropped frame if there is none.
+	bool record(VkCommandBuffer commandBuffer, VkImage image, uint64_t frameNumber) {
+		uint32_t slotIndex;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (freeSlots.empty()) {
+				stats.dropped++;
+				return false;
+			}
+			slotIndex = freeSlots.back();
+			freeSlots.pop_back();
+			stats.captured++;
+		}
+
+		if (stats.captured == 1) {
+			startTime = std::chrono::high_resolution_clock::now();
+		}
+
+		Slot& slot = slots[slotIndex];
+		slot.frameNumber = frameNumber;
+		pendingSlots.push_back(slotIndex);
+
+		VkBufferImageCopy region{};
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.layerCount = 1;
+		region.imageExtent = { extent.width, extent.height, 1 };
+		vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer, 1, &region);
+
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		return true;
+	}
+
+	// Queues every recorded frame up to and including completedFrame for the
+	// writer. The caller guarantees those frames have finished on the GPU.
+	void collect(uint64_t completedFrame) {
+		bool queued = false;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			while (!pendingSlots.empty() && slots[pendingSlots.front()].frameNumber <= completedFrame) {
+				writeQueue.push_back(pendingSlots.front());
+				pendingSlots.pop_front();
+				queued = true;
+			}
+		}
+
+		if (queued) {
+			slotQueued.notify_one();
+		}
+	}
+
+	// Blocks until the writer has drained its queue and rethrows the first
+	// error it hit. Frames still pending on the GPU are not waited for.
+	void flush() {
+		std::unique_lock<std::mutex> lock(mutex);
+		writerIdle.wait(lock, [this]() { return writeQueue.empty() && !writing; });
+
+		if (writerError) {
+			std::exception_ptr error = writerError;
+			writerError = nullptr;
+			std::rethrow_exception(error);
+		}
+	}
+
+	FrameReadbackStats getStats() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return stats;
+	}
+
+	// Seconds from the first recorded frame until now, for sustained rates.
+	double getElapsedSeconds() const {
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+	}
+
+	VkDeviceSize getFrameSize() const {
+		return frameSize;
+	}
+
+	bool isCached() const {
+		return cached;
+	}
+
+private:
+	struct Slot {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		Allocation allocation;
+		uint64_t frameNumber = 0;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	DeviceMemoryAllocator* allocator = nullptr;
+	VkExtent2D extent{};
+	VkDeviceSize frameSize = 0;
+	std::string path;
+	FrameFormat format = FrameFormat::Discard;
+
+	// PNG file names are framePrefix, the zero- or space-padded frame number and
+	// frameSuffix.
+	std::string framePrefix;
+	std::string frameSuffix;
+	size_t frameDigits = 0;
+	char frameFill = '0';
+
+	// Cached memory makes the writer's reads run at normal memory speed instead
+	// of crawling through uncached write-combined pages; if it is not coherent
+	// each frame has to be invalidated before it is read.
+	bool cached = false;
+	bool coherent = true;
+	VkDeviceSize invalidateSize = 0;
+
+	std::vector<Slot> slots;
+	std::vector<uint32_t> freeSlots;
+	std::deque<uint32_t> pendingSlots; // render thread only
+	std::deque<uint32_t> writeQueue;
+
+	mutable std::mutex mutex;
+	std::condition_variable slotQueued;
+	std::condition_variable writerIdle;
+	std::thread writer;
+	bool stopping = false;
+	bool writing = false;
+	std::exception_ptr writerError;
+
+	FrameReadbackStats stats;
+	std::chrono::high_resolution_clock::time_point startTime;
+
+	FILE* output = nullptr;
+	bool outputIsPipe = false;
+	std::vector<uint8_t> y4mFrame;
+
+	void createSlot(Slot& slot, VkDeviceSize nonCoherentAtomSize) {
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = frameSize;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateBuffer(device, &bufferInfo, nullptr, &slot.buffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create readback buffer!");
+		}
+
+		VkMemoryRequirements memRequirements;
+		vkGetBufferMemoryRequirements(device, slot.buffer, &memRequirements);
+
+		const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		uint32_t memoryType;
+		if (allocator->findMemoryType(memRequirements.memoryTypeBits, hostVisible | VK_MEMORY_PROPERTY_HOST_CACHED_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, memoryType)) {
+			cached = true;
+			coherent = true;
+		}
+		else if (allocator->findMemoryType(memRequirements.memoryTypeBits, hostVisible | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, memoryType)) {
+			cached = true;
+			coherent = false;
+		}
+		else {
+			memoryType = allocator->findMemoryType(memRequirements.memoryTypeBits, hostVisible | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			cached = false;
+			coherent = true;
+		}
+
+		// Invalidated ranges must start and end on atom boundaries, so make the
+		// allocation own whole atoms.
+		if (!coherent) {
+			memRequirements.alignment = std::max(memRequirements.alignment, nonCoherentAtomSize);
+			memRequirements.size = alignUp(memRequirements.size, nonCoherentAtomSize);
+			invalidateSize = memRequirements.size;
+		}
+
+		slot.allocation = allocator->allocate(memRequirements, memoryType, true);
+		vkBindBufferMemory(device, slot.buffer, slot.allocation.memory, slot.allocation.offset);
+	}
+
+	void openOutput(uint32_t frameRate) {
+		if (format == FrameFormat::Discard || format == FrameFormat::Png) {
+			return;
+		}
+
+		outputIsPipe = !path.empty() && path[0] == '|';
+		if (outputIsPipe) {
+#ifdef _WIN32
+			output = _popen(path.c_str() + 1, "wb");
+#else
+			output = popen(path.c_str() + 1, "w");
+#endif
+		}
+		else {
+			output = fopen(path.c_str(), "wb");
+		}
+
+		if (!output) {
+			throw std::runtime_error("failed to open " + path + "!");
+		}
+
+		if (format == FrameFormat::Y4m) {
+			fprintf(output, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", extent.width, extent.height, frameRate);
+		}
+	}
+
+	void closeOutput() {
+		if (!output) {
+			return;
+		}
+
+		if (outputIsPipe) {
+#ifdef _WIN32
+			_pclose(output);
+#else
+			pclose(output);
+#endif
+		}
+		else {
+			fclose(output);
+		}
+		output = nullptr;
+	}
+
+	void writerLoop() {
+		while (true) {
+			uint32_t slotIndex;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				slotQueued.wait(lock, [this]() { return stopping || !writeQueue.empty(); });
+
+				if (writeQueue.empty()) {
+					return;
+				}
+
+				slotIndex = writeQueue.front();
+				writeQueue.pop_front();
+				writing = true;
+			}
+
+			auto writeStart = std::chrono::high_resolution_clock::now();
+			uint64_t bytes = 0;
+			std::exception_ptr error;
+			try {
+				bytes = writeFrame(slots[slotIndex]);
+			}
+			catch (...) {
+				error = std::current_exception();
+			}
+			double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - writeStart).count();
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				freeSlots.push_back(slotIndex);
+				writing = false;
+
+				if (error) {
+					if (!writerError) {
+						writerError = error;
+					}
+				}
+				else {
+					stats.written++;
+					stats.bytesWritten += bytes;
+					stats.writeSeconds += seconds;
+				}
+			}
+			writerIdle.notify_all();
+		}
+	}
+
+	// Returns the number of bytes produced for the frame.
+	uint64_t writeFrame(const Slot& slot) {
+		if (!coherent) {
+			VkMappedMemoryRange range{};
+			range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+			range.memory = slot.allocation.memory;
+			range.offset = slot.allocation.offset;
+			range.size = invalidateSize;
+			vkInvalidateMappedMemoryRanges(device, 1, &range);
+		}
+
+		const uint8_t* rgba = static_cast<const uint8_t*>(slot.allocation.mapped);
+
+		switch (format) {
+		case FrameFormat::Raw:
+			writeOutput(rgba, static_cast<size_t>(frameSize));
+			return frameSize;
+		case FrameFormat::Y4m:
+			return writeY4mFrame(rgba);
+		case FrameFormat::Png:
+			return writePng(rgba, slot.frameNumber);
+		default:
+			return 0;
+		}
+	}
+
+	void writeOutput(const void* data, size_t size) {
+		if (fwrite(data, 1, size, output) != size) {
+			throw std::runtime_error("failed to write " + path + "!");
+		}
+	}
+
+	// 4:2:0 BT.601 limited range. The attachment is sRGB, so the stored bytes
+	// are already gamma encoded the way video expects.
+	uint64_t writeY4mFrame(const uint8_t* rgba) {
+		uint32_t width = extent.width;
+		uint32_t height = extent.height;
+		uint32_t chromaWidth = (width + 1) / 2;
+		uint32_t chromaHeight = (height + 1) / 2;
+
+		size_t lumaSize = static_cast<size_t>(width) * height;
+		size_t chromaSize = static_cast<size_t>(chromaWidth) * chromaHeight;
+		y4mFrame.resize(lumaSize + chromaSize * 2);
+
+		uint8_t* yPlane = y4mFrame.data();
+		uint8_t* uPlane = yPlane + lumaSize;
+		uint8_t* vPlane = uPlane + chromaSize;
+
+		for (size_t i = 0; i < lumaSize; i++) {
+			const uint8_t* p = rgba + i * 4;
+			yPlane[i] = static_cast<uint8_t>((66 * p[0] + 129 * p[1] + 25 * p[2] + 128 + (16 << 8)) >> 8);
+		}
+
+		for (uint32_t cy = 0; cy < chromaHeight; cy++) {
+			for (uint32_t cx = 0; cx < chromaWidth; cx++) {
+				int r = 0, g = 0, b = 0, count = 0;
+				for (uint32_t y = cy * 2; y < std::min(cy * 2 + 2, height); y++) {
+					for (uint32_t x = cx * 2; x < std::min(cx * 2 + 2, width); x++) {
+						const uint8_t* p = rgba + (static_cast<size_t>(y) * width + x) * 4;
+						r += p[0];
+						g += p[1];
+						b += p[2];
+						count++;
+					}
+				}
+				r /= count;
+				g /= count;
+				b /= count;
+
+				size_t i = static_cast<size_t>(cy) * chromaWidth + cx;
+				uPlane[i] = static_cast<uint8_t>((-38 * r - 74 * g + 112 * b + 128 + (128 << 8)) >> 8);
+				vPlane[i] = static_cast<uint8_t>((112 * r - 94 * g - 18 * b + 128 + (128 << 8)) >> 8);
+			}
+		}
+
+		static const char frameHeader[] = "FRAME\n";
+		writeOutput(frameHeader, sizeof(frameHeader) - 1);
+		writeOutput(y4mFrame.data(), y4mFrame.size());
+		return sizeof(frameHeader) - 1 + y4mFrame.size();
+	}
+
+	struct PngOutput {
+		FILE* file;
+		uint64_t bytes;
+		bool failed;
+	};
+
+	static void writePngData(void* context, void* data, int size) {
+		PngOutput* png = static_cast<PngOutput*>(context);
+		if (fwrite(data, 1, size, png->file) != static_cast<size_t>(size)) {
+			png->failed = true;
+		}
+		png->bytes += size;
+	}
+
+	uint64_t writePng(const uint8_t* rgba, uint64_t frameNumber) {
+		std::string filename = getFramePath(frameNumber);
+
+		PngOutput png = { fopen(filename.c_str(), "wb"), 0, false };
+		if (!png.file) {
+			throw std::runtime_error("failed to open " + filename + "!");
+		}
+
+		int result = stbi_write_png_to_func(writePngData, &png, static_cast<int>(extent.width), static_cast<int>(extent.height), 4, rgba, static_cast<int>(extent.width * 4));
+		fclose(png.file);
+
+		if (!result || png.failed) {
+			throw std::runtime_error("failed to write " + filename + "!");
+		}
+		return png.bytes;
+	}
+
+	// The path is never handed to printf, so only the conversions below are
+	// accepted and the frame number is substituted by getFramePath.
+	void parseFramePattern() {
+		size_t percent = path.find('%');
+		if (percent == std::string::npos) {
+			size_t dot = path.find_last_of('.');
+			size_t slash = path.find_last_of("/\\");
+			if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+				dot = path.size();
+			}
+			framePrefix = path.substr(0, dot) + "_";
+			frameSuffix = path.substr(dot);
+			frameDigits = 5;
+			frameFill = '0';
+			return;
+		}
+
+		size_t end = percent + 1;
+		frameFill = ' ';
+		if (end < path.size() && path[end] == '0') {
+			frameFill = '0';
+			end++;
+		}
+
+		size_t widthStart = end;
+		while (end < path.size() && path[end] >= '0' && path[end] <= '9') {
+			end++;
+		}
+		if (end - widthStart > 2) {
+			throw std::runtime_error("frame number width too large in " + path + "!");
+		}
+		frameDigits = end > widthStart ? std::stoul(path.substr(widthStart, end - widthStart)) : 0;
+
+		static const char* conversions[] = { "llu", "lld", "lu", "ld", "u", "d", "i" };
+		size_t conversionLength = 0;
+		for (const char* conversion : conversions) {
+			size_t length = strlen(conversion);
+			if (path.compare(end, length, conversion) == 0) {
+				conversionLength = length;
+				break;
+			}
+		}
+		if (conversionLength == 0 || path.find('%', end) != std::string::npos) {
+			throw std::runtime_error("invalid frame number pattern in " + path + "!");
+		}
+
+		framePrefix = path.substr(0, percent);
+		frameSuffix = path.substr(end + conversionLength);
+	}
+
+	std::string getFramePath(uint64_t frameNumber) const {
+		std::string number = std::to_string(frameNumber);
+		if (number.size() < frameDigits) {
+			number.insert(0, frameDigits - number.size(), frameFill);
+		}
+		return framePrefix + number + frameSuffix;
+	}
+};
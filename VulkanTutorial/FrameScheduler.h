@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <stdexcept>
+#include <vector>
+#include <cstdint>
+
+#include "TimelineSemaphore.h"
+
+// Paces frames on a single timeline semaphore. Frame N signals value N + 1 once
+// its submission completes, so the frame that last used a slot is finished when
+// the timeline reaches that slot's previous value, and anything retired during
+// frame N can be released once the timeline passes N + 1. Swap chain acquire and
+// present still need binary semaphores, one pair per slot.
+class FrameScheduler {
+public:
+	void init(VkDevice device, uint32_t framesInFlight) {
+		if (framesInFlight == 0) {
+			throw std::invalid_argument("frames in flight must be at least 1!");
+		}
+
+		this->device = device;
+		this->framesInFlight = framesInFlight;
+
+		timeline.init(device);
+
+		imageAvailableSemaphores.resize(framesInFlight);
+		renderFinishedSemaphores.resize(framesInFlight);
+
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		for (uint32_t i = 0; i < framesInFlight; i++) {
+			if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
+				vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create synchronization objects for a frame!");
+			}
+		}
+	}
+
+	void cleanup() {
+		for (uint32_t i = 0; i < framesInFlight; i++) {
+			vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
+			vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
+		}
+
+		timeline.cleanup();
+	}
+
+	uint32_t getFramesInFlight() const {
+		return framesInFlight;
+	}
+
+	uint32_t getFrameIndex(uint64_t frameNumber) const {
+		return static_cast<uint32_t>(frameNumber % framesInFlight);
+	}
+
+	// The timeline value the frame's submission signals.
+	static uint64_t getFrameValue(uint64_t frameNumber) {
+		return frameNumber + 1;
+	}
+
+	// Blocks until the frame that used frameNumber's slot before it has completed.
+	void waitForFrameSlot(uint64_t frameNumber) {
+		if (frameNumber >= framesInFlight) {
+			timeline.wait(getFrameValue(frameNumber - framesInFlight));
+		}
+	}
+
+	uint64_t getCompletedValue() {
+		return timeline.getCompletedValue();
+	}
+
+	bool isComplete(uint64_t value) {
+		return timeline.isComplete(value);
+	}
+
+	VkSemaphore getTimelineSemaphore() const {
+		return timeline.getHandle();
+	}
+
+	VkSemaphore getImageAvailableSemaphore(uint32_t frameIndex) const {
+		return imageAvailableSemaphores[frameIndex];
+	}
+
+	VkSemaphore getRenderFinishedSemaphore(uint32_t frameIndex) const {
+		return renderFinishedSemaphores[frameIndex];
+	}
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	uint32_t framesInFlight = 0;
+
+	TimelineSemaphore timeline;
+	std::vector<VkSemaphore> imageAvailableSemaphores;
+	std::vector<VkSemaphore> renderFinishedSemaphores;
+};
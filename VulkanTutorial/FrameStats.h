@@ -0,0 +1,315 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+const size_t FRAME_STATS_WINDOW = 1024;
+
+enum class FrameMetric : uint32_t {
+	Interval,
+	Cpu,
+	SlotWait,
+	Acquire,
+	Gpu,
+	Latency,
+	Count
+};
+
+const uint32_t FRAME_METRIC_COUNT = static_cast<uint32_t>(FrameMetric::Count);
+
+inline const char* getFrameMetricName(FrameMetric metric) {
+	switch (metric) {
+	case FrameMetric::Interval:
+		return "frame";
+	case FrameMetric::Cpu:
+		return "cpu";
+	case FrameMetric::SlotWait:
+		return "slot wait";
+	case FrameMetric::Acquire:
+		return "acquire";
+	case FrameMetric::Gpu:
+		return "gpu";
+	case FrameMetric::Latency:
+		return "latency";
+	default:
+		return "unknown";
+	}
+}
+
+// Keeps the last FRAME_STATS_WINDOW values of one metric. Percentiles sort a
+// copy, which is cheap at this size and only happens when a report is made.
+class RollingPercentiles {
+public:
+	void push(double value) {
+		if (values.size() < FRAME_STATS_WINDOW) {
+			values.push_back(value);
+		}
+		else {
+			values[next] = value;
+		}
+		next = (next + 1) % FRAME_STATS_WINDOW;
+	}
+
+	size_t size() const {
+		return values.size();
+	}
+
+	// p in [0, 1]; nearest rank.
+	double percentile(double p) const {
+		if (values.empty()) {
+			return 0.0;
+		}
+
+		std::vector<double> sorted = values;
+		size_t rank = std::min(static_cast<size_t>(p * sorted.size()), sorted.size() - 1);
+		std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+		return sorted[rank];
+	}
+
+	double max() const {
+		return values.empty() ? 0.0 : *std::max_element(values.begin(), values.end());
+	}
+
+private:
+	std::vector<double> values;
+	size_t next = 0;
+};
+
+// Per-frame timings, all in milliseconds:
+//   frame       start of one drawFrame to the start of the next (pacing)
+//   cpu         time in drawFrame not spent blocked on the frame slot or acquire
+//   slot wait   blocked until the frame that last used this slot completed
+//   acquire     blocked in vkAcquireNextImageKHR
+//   gpu         the frame's command buffer, from timestamp queries
+//   latency     input sampled (start of drawFrame, right after polling) to the
+//               frame's GPU work finishing, i.e. when it could be presented
+//
+// plus the bytes the frame pushed through the staging ring, reported in KiB.
+//
+// GPU times arrive frames later, when the frame's slot has been waited on, so
+// samples stay pending until then. The GPU finish time is estimated the same way
+// the profiler places GPU frames: the later of submit and the previous GPU frame
+// finishing, plus the frame's GPU time. Without timestamp support latency falls
+// back to the end of drawFrame, which is after present has been queued.
+class FrameStats {
+public:
+	void init(bool hasGpuTimes, const std::string& csvPath) {
+		this->hasGpuTimes = hasGpuTimes;
+		startTime = std::chrono::high_resolution_clock::now();
+
+		if (!csvPath.empty()) {
+			csv.open(csvPath, std::ios::trunc);
+			if (!csv.is_open()) {
+				throw std::runtime_error("failed to open " + csvPath + "!");
+			}
+			csv << "frame,frame_ms,cpu_ms,slot_wait_ms,acquire_ms,gpu_ms,latency_ms,staged_bytes\n";
+			csv << std::fixed << std::setprecision(4);
+		}
+	}
+
+	// Writes out samples still waiting for GPU times with those columns empty.
+	void cleanup() {
+		for (const auto& sample : pending) {
+			writeCsv(sample);
+		}
+		pending.clear();
+		csv.close();
+	}
+
+	void beginFrame(uint64_t frameNumber) {
+		double now = getTime();
+
+		current = Sample{};
+		current.frameNumber = frameNumber;
+		current.start = now;
+		if (frameStarted) {
+			current.metrics[index(FrameMetric::Interval)] = now - lastFrameStart;
+		}
+		frameStarted = true;
+		lastFrameStart = now;
+	}
+
+	void recordSlotWait(double ms) {
+		current.metrics[index(FrameMetric::SlotWait)] += ms;
+	}
+
+	void recordAcquire(double ms) {
+		current.metrics[index(FrameMetric::Acquire)] += ms;
+	}
+
+	void recordStagedBytes(uint64_t bytes) {
+		current.stagedBytes = bytes;
+	}
+
+	void markSubmit() {
+		current.submit = getTime();
+	}
+
+	void endFrame() {
+		double now = getTime();
+		double blocked = current.metrics[index(FrameMetric::SlotWait)] + current.metrics[index(FrameMetric::Acquire)];
+		current.metrics[index(FrameMetric::Cpu)] = now - current.start - blocked;
+
+		if (!hasGpuTimes) {
+			current.metrics[index(FrameMetric::Latency)] = now - current.start;
+			complete(current);
+			return;
+		}
+
+		pending.push_back(current);
+	}
+
+	void recordGpuTime(uint64_t frameNumber, double ms) {
+		while (!pending.empty() && pending.front().frameNumber < frameNumber) {
+			writeCsv(pending.front());
+			pending.pop_front();
+		}
+		if (pending.empty() || pending.front().frameNumber != frameNumber) {
+			return;
+		}
+
+		Sample sample = pending.front();
+		pending.pop_front();
+
+		double gpuEnd = std::max(sample.submit, lastGpuEnd) + ms;
+		lastGpuEnd = gpuEnd;
+
+		sample.metrics[index(FrameMetric::Gpu)] = ms;
+		sample.metrics[index(FrameMetric::Latency)] = gpuEnd - sample.start;
+		complete(sample);
+	}
+
+	// One line for the window title or the console: fps over the window, then
+	// p50/p95/p99 for the main metrics.
+	std::string getSummary() const {
+		std::ostringstream summary;
+		summary << std::fixed << std::setprecision(1);
+
+		const RollingPercentiles& interval = rolling[index(FrameMetric::Interval)];
+		double medianMs = interval.percentile(0.5);
+		summary << (medianMs > 0.0 ? 1000.0 / medianMs : 0.0) << " fps";
+
+		summary << std::setprecision(2);
+		for (FrameMetric metric : { FrameMetric::Interval, FrameMetric::Cpu, FrameMetric::Gpu, FrameMetric::Latency }) {
+			const RollingPercentiles& values = rolling[index(metric)];
+			if (values.size() == 0 || (metric == FrameMetric::Gpu && !hasGpuTimes)) {
+				continue;
+			}
+			summary << " | " << getFrameMetricName(metric) << " " << values.percentile(0.5) << "/" << values.percentile(0.95) << "/" << values.percentile(0.99);
+		}
+		summary << " ms (p50/p95/p99)";
+
+		if (stagedKiB.size() > 0) {
+			summary << " | staged " << stagedKiB.percentile(0.5) << "/" << stagedKiB.percentile(0.95) << "/" << stagedKiB.percentile(0.99) << " KiB";
+		}
+		return summary.str();
+	}
+
+	void printReport() const {
+		std::cout << "frame stats over the last " << rolling[index(FrameMetric::Interval)].size() << " frames (ms):" << std::endl;
+		std::cout << std::fixed << std::setprecision(3);
+		for (uint32_t i = 0; i < FRAME_METRIC_COUNT; i++) {
+			const RollingPercentiles& values = rolling[i];
+			if (values.size() == 0 || (static_cast<FrameMetric>(i) == FrameMetric::Gpu && !hasGpuTimes)) {
+				continue;
+			}
+			std::cout << "  " << std::left << std::setw(12) << getFrameMetricName(static_cast<FrameMetric>(i)) << std::right
+				<< " p50 " << std::setw(8) << values.percentile(0.5)
+				<< "  p95 " << std::setw(8) << values.percentile(0.95)
+				<< "  p99 " << std::setw(8) << values.percentile(0.99)
+				<< "  max " << std::setw(8) << values.max() << std::endl;
+		}
+		if (stagedKiB.size() > 0) {
+			std::cout << "  " << std::left << std::setw(12) << "staged KiB" << std::right
+				<< " p50 " << std::setw(8) << stagedKiB.percentile(0.5)
+				<< "  p95 " << std::setw(8) << stagedKiB.percentile(0.95)
+				<< "  p99 " << std::setw(8) << stagedKiB.percentile(0.99)
+				<< "  max " << std::setw(8) << stagedKiB.max() << std::endl;
+		}
+		std::cout << std::defaultfloat;
+	}
+
+	const RollingPercentiles& getMetric(FrameMetric metric) const {
+		return rolling[index(metric)];
+	}
+
+	bool hasGpuTimings() const {
+		return hasGpuTimes;
+	}
+
+	double getTime() const {
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	}
+
+private:
+	struct Sample {
+		uint64_t frameNumber = 0;
+		double start = 0.0;
+		double submit = 0.0;
+		std::array<double, FRAME_METRIC_COUNT> metrics{};
+		uint64_t stagedBytes = 0;
+		bool complete = false;
+	};
+
+	bool hasGpuTimes = false;
+	std::chrono::high_resolution_clock::time_point startTime;
+
+	Sample current;
+	bool frameStarted = false;
+	double lastFrameStart = 0.0;
+	double lastGpuEnd = 0.0;
+	std::deque<Sample> pending;
+
+	std::array<RollingPercentiles, FRAME_METRIC_COUNT> rolling;
+	RollingPercentiles stagedKiB;
+	std::ofstream csv;
+
+	static uint32_t index(FrameMetric metric) {
+		return static_cast<uint32_t>(metric);
+	}
+
+	void complete(Sample& sample) {
+		sample.complete = true;
+		for (uint32_t i = 0; i < FRAME_METRIC_COUNT; i++) {
+			// The first frame has no interval to measure.
+			if (static_cast<FrameMetric>(i) == FrameMetric::Interval && sample.metrics[i] == 0.0) {
+				continue;
+			}
+			if (static_cast<FrameMetric>(i) == FrameMetric::Gpu && !hasGpuTimes) {
+				continue;
+			}
+			rolling[i].push(sample.metrics[i]);
+		}
+		stagedKiB.push(sample.stagedBytes / 1024.0);
+		writeCsv(sample);
+	}
+
+	void writeCsv(const Sample& sample) {
+		if (!csv.is_open()) {
+			return;
+		}
+
+		csv << sample.frameNumber;
+		for (uint32_t i = 0; i < FRAME_METRIC_COUNT; i++) {
+			bool missing = !sample.complete && (static_cast<FrameMetric>(i) == FrameMetric::Gpu || static_cast<FrameMetric>(i) == FrameMetric::Latency);
+			if (static_cast<FrameMetric>(i) == FrameMetric::Gpu && !hasGpuTimes) {
+				missing = true;
+			}
+			csv << ',';
+			if (!missing) {
+				csv << sample.metrics[i];
+			}
+		}
+		csv << ',' << sample.stagedBytes << '\n';
+	}
+};
@@ -0,0 +1,337 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <stdexcept>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+const VkDeviceSize DEFAULT_MEMORY_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+inline VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+	return alignment > 1 ? (value + alignment - 1) & ~(alignment - 1) : value;
+}
+
+// Offset/size free list over a single [0, capacity) range. Free ranges are kept
+// sorted by offset so neighbours can be coalesced when a range is returned.
+class FreeList {
+public:
+	explicit FreeList(VkDeviceSize capacity = 0) {
+		reset(capacity);
+	}
+
+	void reset(VkDeviceSize newCapacity) {
+		ranges.clear();
+		capacity = newCapacity;
+		freeBytes = newCapacity;
+
+		if (newCapacity > 0) {
+			ranges[0] = newCapacity;
+		}
+	}
+
+	bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) {
+		auto best = ranges.end();
+
+		for (auto it = ranges.begin(); it != ranges.end(); ++it) {
+			VkDeviceSize padding = alignUp(it->first, alignment) - it->first;
+			if (it->second < padding + size) {
+				continue;
+			}
+
+			if (best == ranges.end() || it->second < best->second) {
+				best = it;
+			}
+		}
+
+		if (best == ranges.end()) {
+			return false;
+		}
+
+		VkDeviceSize rangeOffset = best->first;
+		VkDeviceSize rangeSize = best->second;
+		ranges.erase(best);
+
+		offset = alignUp(rangeOffset, alignment);
+		VkDeviceSize padding = offset - rangeOffset;
+		VkDeviceSize tail = rangeSize - padding - size;
+
+		if (padding > 0) {
+			ranges[rangeOffset] = padding;
+		}
+		if (tail > 0) {
+			ranges[offset + size] = tail;
+		}
+
+		freeBytes -= size;
+		return true;
+	}
+
+	void free(VkDeviceSize offset, VkDeviceSize size) {
+		freeBytes += size;
+
+		auto next = ranges.lower_bound(offset);
+		if (next != ranges.end() && offset + size == next->first) {
+			size += next->second;
+			next = ranges.erase(next);
+		}
+
+		if (next != ranges.begin()) {
+			auto prev = std::prev(next);
+			if (prev->first + prev->second == offset) {
+				prev->second += size;
+				return;
+			}
+		}
+
+		ranges[offset] = size;
+	}
+
+	VkDeviceSize largestFreeRange() const {
+		VkDeviceSize largest = 0;
+		for (const auto& range : ranges) {
+			largest = std::max(largest, range.second);
+		}
+		return largest;
+	}
+
+	// Free bytes outside the largest range, which no single allocation can use.
+	VkDeviceSize getFragmentedBytes() const {
+		return freeBytes - largestFreeRange();
+	}
+
+	VkDeviceSize getCapacity() const { return capacity; }
+	VkDeviceSize getFreeBytes() const { return freeBytes; }
+	size_t getFreeRangeCount() const { return ranges.size(); }
+	bool empty() const { return freeBytes == capacity; }
+
+private:
+	std::map<VkDeviceSize, VkDeviceSize> ranges;
+	VkDeviceSize capacity = 0;
+	VkDeviceSize freeBytes = 0;
+};
+
+struct Allocation {
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	void* mapped = nullptr;
+	uint32_t poolIndex = 0;
+	uint32_t blockIndex = 0;
+};
+
+struct AllocatorStats {
+	uint32_t blockCount = 0;
+	uint32_t allocationCount = 0;
+	VkDeviceSize bytesReserved = 0;
+	VkDeviceSize bytesUsed = 0;
+	VkDeviceSize bytesFragmented = 0;
+};
+
+// Sub-allocates buffers and images out of large VkDeviceMemory blocks. There is
+// one pool per memory type, split into linear (buffers) and optimal-tiling
+// (images) halves so bufferImageGranularity never has to be considered.
+// Host-visible blocks stay mapped for their whole lifetime.
+class DeviceMemoryAllocator {
+public:
+	void init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize = DEFAULT_MEMORY_BLOCK_SIZE) {
+		this->device = device;
+		this->blockSize = blockSize;
+
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+		pools.resize(memProperties.memoryTypeCount * 2);
+	}
+
+	void cleanup() {
+		for (auto& pool : pools) {
+			for (auto& block : pool) {
+				if (block) {
+					releaseBlock(*block);
+				}
+			}
+			pool.clear();
+		}
+	}
+
+	Allocation allocate(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex, bool linear) {
+		uint32_t poolIndex = memoryTypeIndex * 2 + (linear ? 0 : 1);
+		auto& pool = pools[poolIndex];
+
+		VkDeviceSize preferredBlockSize = getPreferredBlockSize(memoryTypeIndex);
+		if (requirements.size > preferredBlockSize / 2) {
+			uint32_t blockIndex = createBlock(poolIndex, memoryTypeIndex, requirements.size, true);
+			return makeAllocation(poolIndex, blockIndex, 0, requirements.size);
+		}
+
+		for (uint32_t i = 0; i < pool.size(); i++) {
+			auto& block = pool[i];
+			VkDeviceSize offset;
+			if (block && !block->dedicated && block->freeList.allocate(requirements.size, requirements.alignment, offset)) {
+				return makeAllocation(poolIndex, i, offset, requirements.size);
+			}
+		}
+
+		uint32_t blockIndex = createBlock(poolIndex, memoryTypeIndex, preferredBlockSize, false);
+
+		VkDeviceSize offset;
+		if (!pool[blockIndex]->freeList.allocate(requirements.size, requirements.alignment, offset)) {
+			throw std::runtime_error("failed to sub-allocate device memory!");
+		}
+
+		return makeAllocation(poolIndex, blockIndex, offset, requirements.size);
+	}
+
+	void free(Allocation& allocation) {
+		if (allocation.memory == VK_NULL_HANDLE) {
+			return;
+		}
+
+		auto& pool = pools[allocation.poolIndex];
+		auto& block = pool[allocation.blockIndex];
+
+		block->allocationCount--;
+		if (!block->dedicated) {
+			block->freeList.free(allocation.offset, allocation.size);
+		}
+
+		if (block->allocationCount == 0 && (block->dedicated || countEmptyBlocks(pool) > 1)) {
+			releaseBlock(*block);
+			block.reset();
+		}
+
+		allocation = Allocation{};
+	}
+
+	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+		uint32_t memoryTypeIndex;
+		if (!findMemoryType(typeFilter, properties, memoryTypeIndex)) {
+			throw std::runtime_error("failed to find suitable memory type!");
+		}
+
+		return memoryTypeIndex;
+	}
+
+	// Non-throwing variant for callers that fall back to other properties.
+	bool findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, uint32_t& memoryTypeIndex) const {
+		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+			if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+				memoryTypeIndex = i;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	AllocatorStats getStats() const {
+		AllocatorStats stats{};
+
+		for (const auto& pool : pools) {
+			for (const auto& block : pool) {
+				if (!block) {
+					continue;
+				}
+
+				stats.blockCount++;
+				stats.allocationCount += block->allocationCount;
+				stats.bytesReserved += block->size;
+
+				if (block->dedicated) {
+					stats.bytesUsed += block->size;
+				}
+				else {
+					stats.bytesUsed += block->size - block->freeList.getFreeBytes();
+					stats.bytesFragmented += block->freeList.getFragmentedBytes();
+				}
+			}
+		}
+
+		return stats;
+	}
+
+private:
+	struct MemoryBlock {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize size = 0;
+		void* mapped = nullptr;
+		FreeList freeList;
+		uint32_t allocationCount = 0;
+		bool dedicated = false;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkDeviceSize blockSize = DEFAULT_MEMORY_BLOCK_SIZE;
+	VkPhysicalDeviceMemoryProperties memProperties{};
+	std::vector<std::vector<std::unique_ptr<MemoryBlock>>> pools;
+
+	VkDeviceSize getPreferredBlockSize(uint32_t memoryTypeIndex) const {
+		VkDeviceSize heapSize = memProperties.memoryHeaps[memProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+		return std::min(blockSize, std::max<VkDeviceSize>(heapSize / 8, 1024 * 1024));
+	}
+
+	uint32_t createBlock(uint32_t poolIndex, uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated) {
+		auto block = std::make_unique<MemoryBlock>();
+		block->size = size;
+		block->dedicated = dedicated;
+		if (!dedicated) {
+			block->freeList.reset(size);
+		}
+
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = size;
+		allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+		if (vkAllocateMemory(device, &allocInfo, nullptr, &block->memory) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate device memory block!");
+		}
+
+		if (memProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+			if (vkMapMemory(device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) != VK_SUCCESS) {
+				throw std::runtime_error("failed to map device memory block!");
+			}
+		}
+
+		auto& pool = pools[poolIndex];
+		for (uint32_t i = 0; i < pool.size(); i++) {
+			if (!pool[i]) {
+				pool[i] = std::move(block);
+				return i;
+			}
+		}
+
+		pool.push_back(std::move(block));
+		return static_cast<uint32_t>(pool.size() - 1);
+	}
+
+	void releaseBlock(MemoryBlock& block) {
+		if (block.mapped) {
+			vkUnmapMemory(device, block.memory);
+		}
+		vkFreeMemory(device, block.memory, nullptr);
+	}
+
+	Allocation makeAllocation(uint32_t poolIndex, uint32_t blockIndex, VkDeviceSize offset, VkDeviceSize size) {
+		auto& block = pools[poolIndex][blockIndex];
+		block->allocationCount++;
+
+		Allocation allocation{};
+		allocation.memory = block->memory;
+		allocation.offset = offset;
+		allocation.size = size;
+		allocation.mapped = block->mapped ? static_cast<char*>(block->mapped) + offset : nullptr;
+		allocation.poolIndex = poolIndex;
+		allocation.blockIndex = blockIndex;
+		return allocation;
+	}
+
+	static size_t countEmptyBlocks(const std::vector<std::unique_ptr<MemoryBlock>>& pool) {
+		return std::count_if(pool.begin(), pool.end(), [](const std::unique_ptr<MemoryBlock>& block) {
+			return block && !block->dedicated && block->allocationCount == 0;
+		});
+	}
+};
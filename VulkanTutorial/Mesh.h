@@ -0,0 +1,517 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <stdexcept>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+const uint32_t MESH_FILE_MAGIC = 0x534d5456; // "VTMS"
+const uint32_t MESH_FILE_VERSION = 2;
+
+// Cache size used to score triangles while reordering, and the FIFO size ACMR
+// is measured against. The optimizer aims a little larger than the measured
+// cache so the order holds up on hardware with bigger caches too.
+const uint32_t VERTEX_CACHE_OPTIMIZE_SIZE = 32;
+const uint32_t VERTEX_CACHE_MEASURE_SIZE = 16;
+
+// Binary mesh layout: header, vertexCount * vertexStride bytes of vertices,
+// then indexCount indices of indexSize bytes, padded to four bytes. The vertex
+// format is an opaque tag for the application's vertex layouts.
+struct MeshFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertexCount;
+	uint32_t vertexFormat;
+	uint32_t vertexStride;
+	uint32_t indexCount;
+	uint32_t indexSize;
+	float boundingSphere[4];
+};
+
+struct MeshView {
+	const void* vertices = nullptr;
+	const void* indices = nullptr;
+	uint32_t vertexCount = 0;
+	uint32_t vertexFormat = 0;
+	uint32_t vertexStride = 0;
+	uint32_t indexCount = 0;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+	glm::vec4 boundingSphere = glm::vec4(0.0f);
+};
+
+inline uint32_t getIndexSize(VkIndexType indexType) {
+	return indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4;
+}
+
+// 16-bit indices whenever every vertex is addressable with them.
+inline VkIndexType chooseIndexType(size_t vertexCount) {
+	return vertexCount <= 65536 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+inline std::vector<char> writeMeshFile(const void* vertices, uint32_t vertexCount, uint32_t vertexFormat, uint32_t vertexStride, const std::vector<uint32_t>& indices, const glm::vec4& boundingSphere) {
+	uint32_t indexSize = getIndexSize(chooseIndexType(vertexCount));
+
+	MeshFileHeader header{};
+	header.magic = MESH_FILE_MAGIC;
+	header.version = MESH_FILE_VERSION;
+	header.vertexCount = vertexCount;
+	header.vertexFormat = vertexFormat;
+	header.vertexStride = vertexStride;
+	header.indexCount = static_cast<uint32_t>(indices.size());
+	header.indexSize = indexSize;
+	memcpy(header.boundingSphere, &boundingSphere, sizeof(header.boundingSphere));
+
+	size_t vertexBytes = static_cast<size_t>(vertexCount) * vertexStride;
+	size_t indexBytes = indices.size() * indexSize;
+
+	std::vector<char> file(sizeof(header) + vertexBytes + ((indexBytes + 3) & ~size_t(3)), 0);
+	memcpy(file.data(), &header, sizeof(header));
+	memcpy(file.data() + sizeof(header), vertices, vertexBytes);
+
+	char* out = file.data() + sizeof(header) + vertexBytes;
+	for (size_t i = 0; i < indices.size(); i++) {
+		if (indexSize == 2) {
+			uint16_t index = static_cast<uint16_t>(indices[i]);
+			memcpy(out + i * 2, &index, 2);
+		}
+		else {
+			memcpy(out + i * 4, &indices[i], 4);
+		}
+	}
+
+	return file;
+}
+
+// The returned view points into data, which must outlive it.
+inline MeshView parseMeshFile(const void* data, size_t size, const std::string& name) {
+	MeshFileHeader header;
+	if (size < sizeof(header)) {
+		throw std::runtime_error("truncated mesh file " + name + "!");
+	}
+	memcpy(&header, data, sizeof(header));
+
+	if (header.magic != MESH_FILE_MAGIC || header.version != MESH_FILE_VERSION) {
+		throw std::runtime_error(name + " is not a supported mesh file!");
+	}
+	if (header.vertexStride == 0 || (header.indexSize != 2 && header.indexSize != 4)) {
+		throw std::runtime_error(name + " has an invalid vertex or index layout!");
+	}
+
+	size_t vertexBytes = static_cast<size_t>(header.vertexCount) * header.vertexStride;
+	size_t indexBytes = static_cast<size_t>(header.indexCount) * header.indexSize;
+	if (size < sizeof(header) + vertexBytes + indexBytes) {
+		throw std::runtime_error("truncated mesh file " + name + "!");
+	}
+
+	MeshView mesh;
+	mesh.vertices = static_cast<const char*>(data) + sizeof(header);
+	mesh.indices = static_cast<const char*>(data) + sizeof(header) + vertexBytes;
+	mesh.vertexCount = header.vertexCount;
+	mesh.vertexFormat = header.vertexFormat;
+	mesh.vertexStride = header.vertexStride;
+	mesh.indexCount = header.indexCount;
+	mesh.indexType = header.indexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	mesh.boundingSphere = glm::vec4(header.boundingSphere[0], header.boundingSphere[1], header.boundingSphere[2], header.boundingSphere[3]);
+	return mesh;
+}
+
+struct ObjIndex {
+	int position;
+	int texcoord;
+	int normal;
+};
+
+// Triangulated OBJ contents; every three corners form a triangle. Indices are
+// zero based, with -1 for attributes a corner does not reference.
+struct ObjData {
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> texcoords;
+	std::vector<ObjIndex> corners;
+};
+
+inline int resolveObjIndex(long index, size_t count) {
+	if (index > 0) {
+		return static_cast<int>(index - 1);
+	}
+	if (index < 0) {
+		return static_cast<int>(static_cast<long>(count) + index);
+	}
+	return -1;
+}
+
+inline ObjData parseObj(const char* data, size_t size, const std::string& name) {
+	ObjData obj;
+	std::vector<ObjIndex> face;
+	std::string line;
+
+	const char* end = data + size;
+	for (const char* cursor = data; cursor < end;) {
+		const char* lineEnd = static_cast<const char*>(memchr(cursor, '\n', end - cursor));
+		if (lineEnd == nullptr) {
+			lineEnd = end;
+		}
+		line.assign(cursor, lineEnd);
+		cursor = lineEnd + 1;
+
+		const char* p = line.c_str();
+		while (*p == ' ' || *p == '\t') p++;
+
+		char* next;
+		if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+			glm::vec3 position;
+			position.x = strtof(p + 2, &next);
+			position.y = strtof(next, &next);
+			position.z = strtof(next, &next);
+			obj.positions.push_back(position);
+		}
+		else if (p[0] == 'v' && p[1] == 'n') {
+			glm::vec3 normal;
+			normal.x = strtof(p + 2, &next);
+			normal.y = strtof(next, &next);
+			normal.z = strtof(next, &next);
+			obj.normals.push_back(normal);
+		}
+		else if (p[0] == 'v' && p[1] == 't') {
+			glm::vec2 texcoord;
+			texcoord.x = strtof(p + 2, &next);
+			texcoord.y = strtof(next, &next);
+			obj.texcoords.push_back(texcoord);
+		}
+		else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+			face.clear();
+			p += 2;
+
+			while (true) {
+				long position = strtol(p, &next, 10);
+				if (next == p) {
+					break;
+				}
+				p = next;
+
+				ObjIndex corner{ resolveObjIndex(position, obj.positions.size()), -1, -1 };
+				if (*p == '/') {
+					p++;
+					if (*p != '/') {
+						corner.texcoord = resolveObjIndex(strtol(p, &next, 10), obj.texcoords.size());
+						p = next;
+					}
+					if (*p == '/') {
+						p++;
+						corner.normal = resolveObjIndex(strtol(p, &next, 10), obj.normals.size());
+						p = next;
+					}
+				}
+
+				if (corner.position < 0 || corner.position >= static_cast<int>(obj.positions.size()) ||
+					corner.texcoord >= static_cast<int>(obj.texcoords.size()) || corner.normal >= static_cast<int>(obj.normals.size())) {
+					throw std::runtime_error("invalid face index in " + name + "!");
+				}
+				face.push_back(corner);
+			}
+
+			// Polygons are fanned around their first corner.
+			for (size_t i = 2; i < face.size(); i++) {
+				obj.corners.push_back(face[0]);
+				obj.corners.push_back(face[i - 1]);
+				obj.corners.push_back(face[i]);
+			}
+		}
+	}
+
+	return obj;
+}
+
+// Average cache miss ratio: post-transform cache misses per triangle for a
+// FIFO cache of cacheSize entries. 0.5 is the practical floor for regular
+// grids; 3.0 means no reuse at all.
+inline float calculateAcmr(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_MEASURE_SIZE) {
+	if (indices.empty()) {
+		return 0.0f;
+	}
+
+	std::vector<uint32_t> timestamps(vertexCount, 0);
+	uint32_t time = cacheSize + 1;
+	uint32_t misses = 0;
+
+	for (uint32_t index : indices) {
+		if (time - timestamps[index] > cacheSize) {
+			timestamps[index] = time++;
+			misses++;
+		}
+	}
+
+	return static_cast<float>(misses) / (indices.size() / 3);
+}
+
+inline float forsythVertexScore(int cachePosition, uint32_t remainingTriangles) {
+	if (remainingTriangles == 0) {
+		return -1.0f;
+	}
+
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+		if (cachePosition < 3) {
+			// The last triangle's vertices score flat so the next pick is not
+			// biased towards reusing just one of them.
+			score = 0.75f;
+		}
+		else {
+			float scale = 1.0f / (VERTEX_CACHE_OPTIMIZE_SIZE - 3);
+			score = std::pow(1.0f - (cachePosition - 3) * scale, 1.5f);
+		}
+	}
+
+	// Boost vertices with few triangles left so they are finished off instead
+	// of being stranded.
+	return score + 2.0f * std::pow(static_cast<float>(remainingTriangles), -0.5f);
+}
+
+// Reorders triangles for the post-transform vertex cache with Tom Forsyth's
+// linear-speed greedy algorithm.
+inline void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	std::vector<uint32_t> triangleOffsets(vertexCount + 1, 0);
+	for (uint32_t index : indices) {
+		triangleOffsets[index + 1]++;
+	}
+	for (size_t v = 0; v < vertexCount; v++) {
+		triangleOffsets[v + 1] += triangleOffsets[v];
+	}
+
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	std::vector<uint32_t> vertexTriangles(indices.size());
+	for (size_t t = 0; t < triangleCount; t++) {
+		for (size_t k = 0; k < 3; k++) {
+			uint32_t v = indices[t * 3 + k];
+			vertexTriangles[triangleOffsets[v] + remaining[v]++] = static_cast<uint32_t>(t);
+		}
+	}
+
+	std::vector<int> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++) {
+		vertexScores[v] = forsythVertexScore(-1, remaining[v]);
+	}
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (size_t t = 0; t < triangleCount; t++) {
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+	}
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> newCache;
+	size_t scanCursor = 0;
+	int64_t bestTriangle = -1;
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+		if (bestTriangle < 0) {
+			// Nothing in the cache touches a live triangle: take the best of the
+			// rest. Scores only go stale upwards for cached vertices, which are
+			// not connected to anything here, so a forward scan is enough.
+			float bestScore = -1.0f;
+			for (size_t t = scanCursor; t < triangleCount; t++) {
+				if (!emitted[t] && triangleScores[t] > bestScore) {
+					bestScore = triangleScores[t];
+					bestTriangle = static_cast<int64_t>(t);
+				}
+			}
+			while (scanCursor < triangleCount && emitted[scanCursor]) {
+				scanCursor++;
+			}
+		}
+
+		uint32_t triangle = static_cast<uint32_t>(bestTriangle);
+		emitted[triangle] = true;
+
+		newCache.clear();
+		for (size_t k = 0; k < 3; k++) {
+			uint32_t v = indices[triangle * 3 + k];
+			output.push_back(v);
+			newCache.push_back(v);
+
+			uint32_t* first = &vertexTriangles[triangleOffsets[v]];
+			uint32_t* last = first + remaining[v];
+			*std::find(first, last, triangle) = *(last - 1);
+			remaining[v]--;
+		}
+
+		for (uint32_t v : cache) {
+			if (std::find(newCache.begin(), newCache.end(), v) == newCache.end()) {
+				newCache.push_back(v);
+			}
+		}
+
+		for (size_t i = 0; i < newCache.size(); i++) {
+			uint32_t v = newCache[i];
+			cachePositions[v] = i < VERTEX_CACHE_OPTIMIZE_SIZE ? static_cast<int>(i) : -1;
+		}
+
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (uint32_t v : newCache) {
+			float score = forsythVertexScore(cachePositions[v], remaining[v]);
+			float delta = score - vertexScores[v];
+			vertexScores[v] = score;
+
+			for (uint32_t i = 0; i < remaining[v]; i++) {
+				uint32_t t = vertexTriangles[triangleOffsets[v] + i];
+				triangleScores[t] += delta;
+				if (triangleScores[t] > bestScore) {
+					bestScore = triangleScores[t];
+					bestTriangle = t;
+				}
+			}
+		}
+
+		if (newCache.size() > VERTEX_CACHE_OPTIMIZE_SIZE) {
+			newCache.resize(VERTEX_CACHE_OPTIMIZE_SIZE);
+		}
+		cache.swap(newCache);
+	}
+
+	indices.swap(output);
+}
+
+// Reduces overdraw after optimizeVertexCache(): the triangle order is split
+// where the simulated cache starts cold, so moving clusters around costs
+// almost no cache hits, and the clusters facing away from the mesh centre are
+// drawn first since they are the most likely to occlude the rest.
+inline void optimizeOverdraw(std::vector<uint32_t>& indices, const glm::vec3* positions, size_t positionStride, size_t vertexCount) {
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	auto position = [&](uint32_t index) -> const glm::vec3& {
+		return *reinterpret_cast<const glm::vec3*>(reinterpret_cast<const char*>(positions) + index * positionStride);
+	};
+
+	std::vector<uint32_t> clusterStarts;
+	std::vector<uint32_t> timestamps(vertexCount, 0);
+	uint32_t time = VERTEX_CACHE_MEASURE_SIZE + 1;
+
+	for (size_t t = 0; t < triangleCount; t++) {
+		uint32_t misses = 0;
+		for (size_t k = 0; k < 3; k++) {
+			uint32_t v = indices[t * 3 + k];
+			if (time - timestamps[v] > VERTEX_CACHE_MEASURE_SIZE) {
+				timestamps[v] = time++;
+				misses++;
+			}
+		}
+		if (t == 0 || misses == 3) {
+			clusterStarts.push_back(static_cast<uint32_t>(t));
+		}
+	}
+	clusterStarts.push_back(static_cast<uint32_t>(triangleCount));
+
+	size_t clusterCount = clusterStarts.size() - 1;
+	std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+
+	for (size_t c = 0; c < clusterCount; c++) {
+		float clusterArea = 0.0f;
+		for (uint32_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+			const glm::vec3& p0 = position(indices[t * 3]);
+			const glm::vec3& p1 = position(indices[t * 3 + 1]);
+			const glm::vec3& p2 = position(indices[t * 3 + 2]);
+
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float area = glm::length(normal);
+			glm::vec3 centroid = (p0 + p1 + p2) / 3.0f;
+
+			clusterCentroids[c] += centroid * area;
+			clusterNormals[c] += normal;
+			clusterArea += area;
+		}
+
+		meshCentroid += clusterCentroids[c];
+		meshArea += clusterArea;
+		clusterCentroids[c] = clusterArea > 0.0f ? clusterCentroids[c] / clusterArea : position(indices[clusterStarts[c] * 3]);
+	}
+	meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : glm::vec3(0.0f);
+
+	std::vector<float> sortKeys(clusterCount);
+	std::vector<uint32_t> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++) {
+		float normalLength = glm::length(clusterNormals[c]);
+		glm::vec3 normal = normalLength > 0.0f ? clusterNormals[c] / normalLength : glm::vec3(0.0f);
+		sortKeys[c] = glm::dot(clusterCentroids[c] - meshCentroid, normal);
+		order[c] = static_cast<uint32_t>(c);
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		return sortKeys[a] > sortKeys[b];
+	});
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+	for (uint32_t c : order) {
+		output.insert(output.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+	}
+
+	indices.swap(output);
+}
+
+// Renumbers vertices in order of first use so the vertex fetch walks memory
+// forwards; vertices no triangle references are dropped.
+template<typename Vertex>
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+	std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+	std::vector<Vertex> reordered;
+	reordered.reserve(vertices.size());
+
+	for (auto& index : indices) {
+		if (remap[index] == UINT32_MAX) {
+			remap[index] = static_cast<uint32_t>(reordered.size());
+			reordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices.swap(reordered);
+}
+
+inline glm::vec4 computeBoundingSphere(const glm::vec3* positions, size_t positionStride, size_t vertexCount) {
+	if (vertexCount == 0) {
+		return glm::vec4(0.0f);
+	}
+
+	auto position = [&](size_t index) -> const glm::vec3& {
+		return *reinterpret_cast<const glm::vec3*>(reinterpret_cast<const char*>(positions) + index * positionStride);
+	};
+
+	glm::vec3 minPos = position(0);
+	glm::vec3 maxPos = position(0);
+	for (size_t i = 0; i < vertexCount; i++) {
+		minPos = glm::min(minPos, position(i));
+		maxPos = glm::max(maxPos, position(i));
+	}
+
+	glm::vec3 center = (minPos + maxPos) * 0.5f;
+	float radius = 0.0f;
+	for (size_t i = 0; i < vertexCount; i++) {
+		radius = std::max(radius, glm::length(position(i) - center));
+	}
+
+	return glm::vec4(center, radius);
+}
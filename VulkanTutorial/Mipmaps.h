@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIPMAPS_USE_SSE2 1
+#endif
+
+inline uint32_t calculateMipLevels(uint32_t width, uint32_t height) {
+	uint32_t levels = 1;
+	for (uint32_t size = std::max(width, height); size > 1; size >>= 1) {
+		levels++;
+	}
+	return levels;
+}
+
+inline uint32_t mipExtent(uint32_t extent, uint32_t level) {
+	return std::max(extent >> level, 1u);
+}
+
+// 2x2 box filter for RGBA8 rows. Odd source sizes clamp the last column/row,
+// so every source texel still contributes to the level below it.
+inline void downsampleRGBA8(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint8_t* dst) {
+	uint32_t dstWidth = std::max(srcWidth / 2, 1u);
+	uint32_t dstHeight = std::max(srcHeight / 2, 1u);
+
+	for (uint32_t y = 0; y < dstHeight; y++) {
+		const uint8_t* row0 = src + static_cast<size_t>(std::min(y * 2, srcHeight - 1)) * srcWidth * 4;
+		const uint8_t* row1 = src + static_cast<size_t>(std::min(y * 2 + 1, srcHeight - 1)) * srcWidth * 4;
+		uint8_t* out = dst + static_cast<size_t>(y) * dstWidth * 4;
+
+		uint32_t x = 0;
+
+#ifdef MIPMAPS_USE_SSE2
+		// Four output texels per iteration: widen both rows to 16 bits, add them,
+		// then add neighbouring texel pairs and round.
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i rounding = _mm_set1_epi16(2);
+		for (; x + 4 <= dstWidth && x * 2 + 8 <= srcWidth; x += 4) {
+			__m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+			__m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8 + 16));
+			__m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+			__m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8 + 16));
+
+			__m128i sum0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+			__m128i sum1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+			__m128i sum2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+			__m128i sum3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+			__m128i texels01 = _mm_add_epi16(_mm_unpacklo_epi64(sum0, sum1), _mm_unpackhi_epi64(sum0, sum1));
+			__m128i texels23 = _mm_add_epi16(_mm_unpacklo_epi64(sum2, sum3), _mm_unpackhi_epi64(sum2, sum3));
+
+			texels01 = _mm_srli_epi16(_mm_add_epi16(texels01, rounding), 2);
+			texels23 = _mm_srli_epi16(_mm_add_epi16(texels23, rounding), 2);
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4), _mm_packus_epi16(texels01, texels23));
+		}
+#endif
+
+		for (; x < dstWidth; x++) {
+			uint32_t x0 = std::min(x * 2, srcWidth - 1) * 4;
+			uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1) * 4;
+			for (uint32_t c = 0; c < 4; c++) {
+				out[x * 4 + c] = static_cast<uint8_t>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+			}
+		}
+	}
+}
+
+// Returns every level of the chain, level 0 included. Filtering happens on the
+// stored values, which for sRGB data slightly darkens high-contrast detail
+// compared with a linear-space blit.
+inline std::vector<std::vector<uint8_t>> generateMipChain(const uint8_t* pixels, uint32_t width, uint32_t height) {
+	uint32_t mipLevels = calculateMipLevels(width, height);
+
+	std::vector<std::vector<uint8_t>> levels(mipLevels);
+	levels[0].assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+
+	for (uint32_t level = 1; level < mipLevels; level++) {
+		levels[level].resize(static_cast<size_t>(mipExtent(width, level)) * mipExtent(height, level) * 4);
+		downsampleRGBA8(levels[level - 1].data(), mipExtent(width, level - 1), mipExtent(height, level - 1), levels[level].data());
+	}
+
+	return levels;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <cstdint>
+
+#include "ThreadPool.h"
+
+// Records a draw list into secondary command buffers on the thread pool. Every
+// worker chunk owns one command pool per frame in flight, so pools are never
+// touched by two threads at once and can be reset wholesale each frame.
+class ParallelRecorder {
+public:
+	void init(VkDevice device, ThreadPool* threadPool, uint32_t queueFamilyIndex, uint32_t framesInFlight) {
+		this->device = device;
+		this->threadPool = threadPool;
+		threadCount = threadPool->getThreadCount();
+
+		commandPools.resize(framesInFlight * threadCount);
+		commandBuffers.resize(framesInFlight * threadCount);
+
+		for (size_t i = 0; i < commandPools.size(); i++) {
+			VkCommandPoolCreateInfo poolInfo{};
+			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+			poolInfo.queueFamilyIndex = queueFamilyIndex;
+
+			if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPools[i]) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create recording command pool!");
+			}
+
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = commandPools[i];
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandBufferCount = 1;
+
+			if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffers[i]) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate secondary command buffer!");
+			}
+		}
+	}
+
+	void cleanup() {
+		for (auto commandPool : commandPools) {
+			vkDestroyCommandPool(device, commandPool, nullptr);
+		}
+		commandPools.clear();
+		commandBuffers.clear();
+	}
+
+	// Splits drawCount draws over up to chunkCount workers and returns the
+	// recorded secondaries in draw order, ready for vkCmdExecuteCommands.
+	void record(uint32_t frame, const VkCommandBufferInheritanceInfo& inheritanceInfo, uint32_t drawCount, uint32_t chunkCount,
+		const std::function<void(VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end)>& recordDraws,
+		std::vector<VkCommandBuffer>& secondaries) {
+		chunkCount = std::min(std::min(chunkCount, threadCount), drawCount);
+		secondaries.resize(chunkCount);
+
+		threadPool->parallelFor(drawCount, chunkCount, [&](uint32_t chunk, uint32_t begin, uint32_t end) {
+			uint32_t index = frame * threadCount + chunk;
+			vkResetCommandPool(device, commandPools[index], 0);
+
+			VkCommandBufferBeginInfo beginInfo{};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+			beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+			VkCommandBuffer commandBuffer = commandBuffers[index];
+			if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+				throw std::runtime_error("failed to begin recording secondary command buffer!");
+			}
+
+			recordDraws(commandBuffer, begin, end);
+
+			if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+				throw std::runtime_error("failed to record secondary command buffer!");
+			}
+
+			secondaries[chunk] = commandBuffer;
+		});
+	}
+
+	uint32_t getThreadCount() const {
+		return threadCount;
+	}
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	ThreadPool* threadPool = nullptr;
+	uint32_t threadCount = 0;
+
+	std::vector<VkCommandPool> commandPools;
+	std::vector<VkCommandBuffer> commandBuffers;
+};
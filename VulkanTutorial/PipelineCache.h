@@ -0,0 +1,155 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <stdexcept>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+const uint32_t PIPELINE_CACHE_FILE_MAGIC = 0x43505456; // "VTPC"
+
+// Prefixed to the driver's cache blob on disk. The blob's own header carries the
+// vendor, device and cache UUID but not the driver version, and a driver update
+// is the most common reason a stale cache gets handed back to the driver.
+struct PipelineCacheFileHeader {
+	uint32_t magic;
+	uint32_t driverVersion;
+	uint64_t dataSize;
+};
+
+// VkPipelineCache that is seeded from a file at startup and written back on
+// cleanup. Data from another device or driver is discarded rather than passed
+// to vkCreatePipelineCache.
+class PipelineCache {
+public:
+	void init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path) {
+		this->device = device;
+		this->path = path;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+		std::vector<char> data = load();
+		warm = !data.empty();
+
+		VkPipelineCacheCreateInfo cacheInfo{};
+		cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		cacheInfo.initialDataSize = data.size();
+		cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+		if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create pipeline cache!");
+		}
+	}
+
+	void cleanup() {
+		save();
+		vkDestroyPipelineCache(device, cache, nullptr);
+	}
+
+	VkPipelineCache get() const {
+		return cache;
+	}
+
+	bool isWarm() const {
+		return warm;
+	}
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDeviceProperties properties{};
+	std::string path;
+
+	VkPipelineCache cache = VK_NULL_HANDLE;
+	bool warm = false;
+
+	std::vector<char> load() const {
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open()) {
+			return {};
+		}
+
+		PipelineCacheFileHeader fileHeader{};
+		if (!file.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader)) || fileHeader.magic != PIPELINE_CACHE_FILE_MAGIC) {
+			std::cerr << "pipeline cache: ignoring " << path << " (unrecognized file)" << std::endl;
+			return {};
+		}
+
+		if (fileHeader.driverVersion != properties.driverVersion) {
+			std::cerr << "pipeline cache: ignoring " << path << " (driver version changed)" << std::endl;
+			return {};
+		}
+
+		std::vector<char> data(static_cast<size_t>(fileHeader.dataSize));
+		if (!file.read(data.data(), data.size()) || !isCompatible(data)) {
+			std::cerr << "pipeline cache: ignoring " << path << " (written for a different device)" << std::endl;
+			return {};
+		}
+
+		return data;
+	}
+
+	bool isCompatible(const std::vector<char>& data) const {
+		VkPipelineCacheHeaderVersionOne header{};
+		if (data.size() < sizeof(header)) {
+			return false;
+		}
+		memcpy(&header, data.data(), sizeof(header));
+
+		return header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+			header.vendorID == properties.vendorID &&
+			header.deviceID == properties.deviceID &&
+			memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+
+	void save() const {
+		size_t dataSize = 0;
+		if (vkGetPipelineCacheData(device, cache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+			return;
+		}
+
+		std::vector<char> data(dataSize);
+		if (vkGetPipelineCacheData(device, cache, &dataSize, data.data()) != VK_SUCCESS) {
+			return;
+		}
+
+		PipelineCacheFileHeader fileHeader{};
+		fileHeader.magic = PIPELINE_CACHE_FILE_MAGIC;
+		fileHeader.driverVersion = properties.driverVersion;
+		fileHeader.dataSize = dataSize;
+
+		// Write next to the old file and rename it over the top, so a process killed
+		// halfway through never leaves a truncated cache behind.
+		std::string tempPath = path + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open()) {
+				std::cerr << "pipeline cache: failed to write " << tempPath << std::endl;
+				return;
+			}
+
+			file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+			file.write(data.data(), dataSize);
+			file.close();
+
+			// A short write (a full disk, say) must not replace the good cache.
+			if (file.fail()) {
+				std::cerr << "pipeline cache: failed to write " << tempPath << std::endl;
+				std::remove(tempPath.c_str());
+				return;
+			}
+		}
+
+		// Replaces an existing file in one step on Windows as well as POSIX.
+		std::error_code error;
+		std::filesystem::rename(tempPath, path, error);
+		if (error) {
+			std::cerr << "pipeline cache: failed to replace " << path << ": " << error.message() << std::endl;
+			std::remove(tempPath.c_str());
+		}
+	}
+};
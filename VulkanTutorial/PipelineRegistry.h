@@ -0,0 +1,313 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <stdexcept>
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+#include "ThreadPool.h"
+
+const uint32_t MAX_PIPELINE_VERTEX_BINDINGS = 4;
+const uint32_t MAX_PIPELINE_VERTEX_ATTRIBUTES = 8;
+
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+const uint64_t FNV_PRIME = 1099511628211ull;
+
+inline uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ bytes[i]) * FNV_PRIME;
+	}
+	return hash;
+}
+
+template <typename T>
+inline uint64_t hashValue(uint64_t hash, const T& value) {
+	return hashBytes(hash, &value, sizeof(value));
+}
+
+// Everything that varies between the graphics pipelines this app creates. The
+// remaining state (viewport and scissor as dynamic state, single-sampled, no
+// depth) is shared by every variant.
+struct PipelineStateDesc {
+	VkShaderModule vertexShader = VK_NULL_HANDLE;
+	VkShaderModule fragmentShader = VK_NULL_HANDLE;
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	uint32_t subpass = 0;
+
+	uint32_t bindingCount = 0;
+	VkVertexInputBindingDescription bindings[MAX_PIPELINE_VERTEX_BINDINGS]{};
+	uint32_t attributeCount = 0;
+	VkVertexInputAttributeDescription attributes[MAX_PIPELINE_VERTEX_ATTRIBUTES]{};
+
+	VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+	VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	VkBool32 blendEnable = VK_FALSE;
+
+	template <size_t BindingCount, size_t AttributeCount>
+	void setVertexLayout(const std::array<VkVertexInputBindingDescription, BindingCount>& bindingDescriptions,
+		const std::array<VkVertexInputAttributeDescription, AttributeCount>& attributeDescriptions) {
+		static_assert(BindingCount <= MAX_PIPELINE_VERTEX_BINDINGS, "too many vertex bindings");
+		static_assert(AttributeCount <= MAX_PIPELINE_VERTEX_ATTRIBUTES, "too many vertex attributes");
+
+		bindingCount = static_cast<uint32_t>(BindingCount);
+		std::copy(bindingDescriptions.begin(), bindingDescriptions.end(), bindings);
+		attributeCount = static_cast<uint32_t>(AttributeCount);
+		std::copy(attributeDescriptions.begin(), attributeDescriptions.end(), attributes);
+	}
+
+	// Hashed and compared field by field so struct padding never leaks in.
+	uint64_t hash() const {
+		uint64_t hash = FNV_OFFSET_BASIS;
+		hash = hashValue(hash, vertexShader);
+		hash = hashValue(hash, fragmentShader);
+		hash = hashValue(hash, layout);
+		hash = hashValue(hash, renderPass);
+		hash = hashValue(hash, subpass);
+		hash = hashValue(hash, bindingCount);
+		hash = hashBytes(hash, bindings, sizeof(bindings[0]) * bindingCount);
+		hash = hashValue(hash, attributeCount);
+		hash = hashBytes(hash, attributes, sizeof(attributes[0]) * attributeCount);
+		hash = hashValue(hash, topology);
+		hash = hashValue(hash, cullMode);
+		hash = hashValue(hash, frontFace);
+		hash = hashValue(hash, blendEnable);
+		return hash;
+	}
+
+	bool operator==(const PipelineStateDesc& other) const {
+		return vertexShader == other.vertexShader &&
+			fragmentShader == other.fragmentShader &&
+			layout == other.layout &&
+			renderPass == other.renderPass &&
+			subpass == other.subpass &&
+			bindingCount == other.bindingCount &&
+			memcmp(bindings, other.bindings, sizeof(bindings[0]) * bindingCount) == 0 &&
+			attributeCount == other.attributeCount &&
+			memcmp(attributes, other.attributes, sizeof(attributes[0]) * attributeCount) == 0 &&
+			topology == other.topology &&
+			cullMode == other.cullMode &&
+			frontFace == other.frontFace &&
+			blendEnable == other.blendEnable;
+	}
+};
+
+struct PipelineStateDescHash {
+	size_t operator()(const PipelineStateDesc& desc) const {
+		return static_cast<size_t>(desc.hash());
+	}
+};
+
+// Hands out one VkPipeline per distinct PipelineStateDesc. request() never
+// blocks: a variant that has not been built yet is queued on a background
+// compile thread and the caller's fallback is returned until it is ready.
+class PipelineRegistry {
+public:
+	void init(VkDevice device, VkPipelineCache pipelineCache) {
+		this->device = device;
+		this->pipelineCache = pipelineCache;
+		compiler.init(1);
+	}
+
+	void cleanup() {
+		compiler.wait();
+		compiler.cleanup();
+
+		for (auto& entry : pipelines) {
+			if (entry.second.pipeline != VK_NULL_HANDLE) {
+				vkDestroyPipeline(device, entry.second.pipeline, nullptr);
+			}
+		}
+		pipelines.clear();
+	}
+
+	// Compiles on the calling thread if needed. Meant for pipelines that have to
+	// exist before the first frame, such as the fallbacks.
+	VkPipeline getOrCreate(const PipelineStateDesc& desc) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto it = pipelines.find(desc);
+			if (it != pipelines.end() && it->second.pipeline != VK_NULL_HANDLE) {
+				return it->second.pipeline;
+			}
+		}
+
+		VkPipeline pipeline = compile(desc);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		auto& entry = pipelines[desc];
+		if (entry.pipeline != VK_NULL_HANDLE) {
+			vkDestroyPipeline(device, pipeline, nullptr);
+			return entry.pipeline;
+		}
+		entry.pipeline = pipeline;
+		entry.error.clear();
+		return pipeline;
+	}
+
+	// Throws once a background compile of desc has failed, so the failure is
+	// reported on the next frame instead of the fallback being used for good.
+	VkPipeline request(const PipelineStateDesc& desc, VkPipeline fallback) {
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto it = pipelines.find(desc);
+		if (it != pipelines.end()) {
+			if (!it->second.error.empty()) {
+				throw std::runtime_error("failed to compile pipeline variant: " + it->second.error);
+			}
+			return it->second.pipeline != VK_NULL_HANDLE ? it->second.pipeline : fallback;
+		}
+
+		pipelines.emplace(desc, PipelineEntry{});
+		compiler.submit([this, desc]() {
+			VkPipeline pipeline = VK_NULL_HANDLE;
+			std::string error;
+			try {
+				pipeline = compile(desc);
+			}
+			catch (const std::exception& e) {
+				error = e.what();
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+			PipelineEntry& entry = pipelines[desc];
+			if (entry.pipeline != VK_NULL_HANDLE) {
+				// getOrCreate got there first.
+				if (pipeline != VK_NULL_HANDLE) {
+					vkDestroyPipeline(device, pipeline, nullptr);
+				}
+				return;
+			}
+			entry.pipeline = pipeline;
+			entry.error = error;
+		});
+
+		return fallback;
+	}
+
+	// Blocks until every background compile queued so far has finished.
+	void waitIdle() {
+		compiler.wait();
+	}
+
+	size_t getPipelineCount() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return pipelines.size();
+	}
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+
+	struct PipelineEntry {
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		std::string error;
+	};
+
+	ThreadPool compiler;
+	std::mutex mutex;
+	std::unordered_map<PipelineStateDesc, PipelineEntry, PipelineStateDescHash> pipelines;
+
+	VkPipeline compile(const PipelineStateDesc& desc) const {
+		VkPipelineShaderStageCreateInfo shaderStages[2]{};
+		shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+		shaderStages[0].module = desc.vertexShader;
+		shaderStages[0].pName = "main";
+
+		shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+		shaderStages[1].module = desc.fragmentShader;
+		shaderStages[1].pName = "main";
+
+		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		vertexInputInfo.vertexBindingDescriptionCount = desc.bindingCount;
+		vertexInputInfo.pVertexBindingDescriptions = desc.bindings;
+		vertexInputInfo.vertexAttributeDescriptionCount = desc.attributeCount;
+		vertexInputInfo.pVertexAttributeDescriptions = desc.attributes;
+
+		VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		inputAssembly.topology = desc.topology;
+		inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+		VkPipelineViewportStateCreateInfo viewportState{};
+		viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewportState.viewportCount = 1;
+		viewportState.scissorCount = 1;
+
+		VkPipelineRasterizationStateCreateInfo rasterizer{};
+		rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		rasterizer.depthClampEnable = VK_FALSE;
+		rasterizer.rasterizerDiscardEnable = VK_FALSE;
+		rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+		rasterizer.lineWidth = 1.0f;
+		rasterizer.cullMode = desc.cullMode;
+		rasterizer.frontFace = desc.frontFace;
+		rasterizer.depthBiasEnable = VK_FALSE;
+
+		VkPipelineMultisampleStateCreateInfo multisampling{};
+		multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		multisampling.sampleShadingEnable = VK_FALSE;
+		multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+		VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+		colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		colorBlendAttachment.blendEnable = desc.blendEnable;
+		colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+		colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+		colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+		colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+		VkPipelineColorBlendStateCreateInfo colorBlending{};
+		colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		colorBlending.logicOpEnable = VK_FALSE;
+		colorBlending.logicOp = VK_LOGIC_OP_COPY;
+		colorBlending.attachmentCount = 1;
+		colorBlending.pAttachments = &colorBlendAttachment;
+
+		VkDynamicState dynamicStates[] = {
+			VK_DYNAMIC_STATE_VIEWPORT,
+			VK_DYNAMIC_STATE_SCISSOR
+		};
+		VkPipelineDynamicStateCreateInfo dynamicState{};
+		dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+		dynamicState.dynamicStateCount = 2;
+		dynamicState.pDynamicStates = dynamicStates;
+
+		VkGraphicsPipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineInfo.stageCount = 2;
+		pipelineInfo.pStages = shaderStages;
+		pipelineInfo.pVertexInputState = &vertexInputInfo;
+		pipelineInfo.pInputAssemblyState = &inputAssembly;
+		pipelineInfo.pViewportState = &viewportState;
+		pipelineInfo.pRasterizationState = &rasterizer;
+		pipelineInfo.pMultisampleState = &multisampling;
+		pipelineInfo.pColorBlendState = &colorBlending;
+		pipelineInfo.pDynamicState = &dynamicState;
+		pipelineInfo.layout = desc.layout;
+		pipelineInfo.renderPass = desc.renderPass;
+		pipelineInfo.subpass = desc.subpass;
+		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+		VkPipeline pipeline;
+		if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create graphics pipeline!");
+		}
+
+		return pipeline;
+	}
+};
@@ -0,0 +1,365 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+const uint32_t PROFILER_MAX_GPU_SCOPES = 32;
+const size_t PROFILER_MAX_TRACE_EVENTS = 1000000;
+
+class Profiler;
+
+struct ProfileScopeStats {
+	double totalUs = 0.0;
+	double maxUs = 0.0;
+	uint64_t count = 0;
+};
+
+// Times the enclosing block on the calling thread. Empty when profiling is off.
+class CpuScope {
+public:
+	CpuScope(Profiler* profiler, const char* name);
+	~CpuScope();
+
+	CpuScope(CpuScope&& other) noexcept : profiler(other.profiler), name(other.name), start(other.start) {
+		other.profiler = nullptr;
+	}
+
+	CpuScope(const CpuScope&) = delete;
+	CpuScope& operator=(const CpuScope&) = delete;
+
+private:
+	Profiler* profiler;
+	const char* name;
+	std::chrono::high_resolution_clock::time_point start;
+};
+
+// Collects CPU scopes from any thread and GPU scopes from timestamp queries,
+// keeps per-scope totals and exports everything as a Chrome trace (load it in
+// chrome://tracing or ui.perfetto.dev).
+//
+// Each frame in flight owns a query pool. Its timestamps are read back when the
+// frame slot comes round again, after the slot has been waited on, so reading
+// them never stalls. Vulkan 1.0 has no shared clock between CPU and GPU, so each
+// GPU frame is placed on the CPU timeline at its submit time or at the end of
+// the previous GPU frame, whichever is later; times within a frame are exact.
+//
+// Timestamps are written whenever the queue supports them, even with profiling
+// off, so the first (outermost) scope of each frame is always available as the
+// frame's GPU time through getGpuFrameMs(). Only events and totals need enabled.
+class Profiler {
+public:
+	void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex, uint32_t frameCount, bool enabled) {
+		this->device = device;
+		this->enabled = enabled;
+		startTime = std::chrono::high_resolution_clock::now();
+
+		// The thread that sets the profiler up is the one the trace calls "main".
+		if (enabled) {
+			getThreadIndex();
+		}
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		timestampPeriod = properties.limits.timestampPeriod;
+
+		uint32_t queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+		uint32_t validBits = queueFamilies[queueFamilyIndex].timestampValidBits;
+		if (validBits == 0) {
+			if (enabled) {
+				std::cout << "profiler: queue family has no timestamp support, GPU scopes disabled" << std::endl;
+			}
+			return;
+		}
+		timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+		frames.resize(frameCount);
+		for (auto& frame : frames) {
+			VkQueryPoolCreateInfo poolInfo{};
+			poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			poolInfo.queryCount = PROFILER_MAX_GPU_SCOPES * 2;
+
+			if (vkCreateQueryPool(device, &poolInfo, nullptr, &frame.queryPool) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create timestamp query pool!");
+			}
+		}
+		gpuEnabled = true;
+	}
+
+	void cleanup() {
+		for (auto& frame : frames) {
+			vkDestroyQueryPool(device, frame.queryPool, nullptr);
+		}
+		frames.clear();
+	}
+
+	bool isEnabled() const {
+		return enabled;
+	}
+
+	bool hasGpuTimestamps() const {
+		return gpuEnabled;
+	}
+
+	// GPU time of the frame slot's outermost scope, as read by the last
+	// beginFrame() on that slot, or a negative value if there was none.
+	double getGpuFrameMs(uint32_t frame) const {
+		return gpuEnabled ? frames[frame].gpuFrameMs : -1.0;
+	}
+
+	// Call once the frame slot has been waited on. Turns the queries it
+	// recorded last time round into events and makes it the current slot.
+	void beginFrame(uint32_t frame) {
+		if (!gpuEnabled) {
+			return;
+		}
+
+		collect(frames[frame]);
+
+		currentFrame = frame;
+		frames[frame].scopes.clear();
+	}
+
+	// Must be the first thing recorded into the frame's command buffer.
+	void resetQueries(VkCommandBuffer commandBuffer) {
+		if (!gpuEnabled) {
+			return;
+		}
+
+		vkCmdResetQueryPool(commandBuffer, frames[currentFrame].queryPool, 0, PROFILER_MAX_GPU_SCOPES * 2);
+	}
+
+	// Both ends are written at BOTTOM_OF_PIPE so that consecutive scopes measure
+	// how long each pass kept the GPU busy after the previous one finished.
+	uint32_t beginGpuScope(VkCommandBuffer commandBuffer, const char* name) {
+		if (!gpuEnabled || frames[currentFrame].scopes.size() >= PROFILER_MAX_GPU_SCOPES) {
+			return UINT32_MAX;
+		}
+
+		FrameQueries& frame = frames[currentFrame];
+		uint32_t scope = static_cast<uint32_t>(frame.scopes.size());
+		frame.scopes.push_back(name);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.queryPool, scope * 2);
+		return scope;
+	}
+
+	void endGpuScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+		if (scope == UINT32_MAX) {
+			return;
+		}
+
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frames[currentFrame].queryPool, scope * 2 + 1);
+	}
+
+	// Anchors the current frame's GPU scopes on the CPU timeline.
+	void markSubmit() {
+		if (!gpuEnabled) {
+			return;
+		}
+
+		frames[currentFrame].submitTime = now();
+	}
+
+	CpuScope cpuScope(const char* name) {
+		return CpuScope(enabled ? this : nullptr, name);
+	}
+
+	// Collects the queries of every frame slot. The device must be idle.
+	void finish() {
+		for (auto& frame : frames) {
+			collect(frame);
+			frame.scopes.clear();
+		}
+	}
+
+	void addCpuEvent(const char* name, std::chrono::high_resolution_clock::time_point start, std::chrono::high_resolution_clock::time_point end) {
+		double startUs = std::chrono::duration<double, std::micro>(start - startTime).count();
+		double durationUs = std::chrono::duration<double, std::micro>(end - start).count();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		addEvent(cpuStats, name, getThreadIndex(), startUs, durationUs);
+	}
+
+	std::map<std::string, ProfileScopeStats> getCpuStats() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return cpuStats;
+	}
+
+	std::map<std::string, ProfileScopeStats> getGpuStats() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return gpuStats;
+	}
+
+	void printStats() const {
+		std::lock_guard<std::mutex> lock(mutex);
+
+		std::cout << std::fixed << std::setprecision(3);
+		printStats("cpu", cpuStats);
+		printStats("gpu", gpuStats);
+		std::cout << std::defaultfloat;
+
+		if (droppedEvents > 0) {
+			std::cout << "profiler: trace full, " << droppedEvents << " events not recorded" << std::endl;
+		}
+	}
+
+	void writeTrace(const std::string& path) const {
+		std::lock_guard<std::mutex> lock(mutex);
+
+		std::ofstream file(path, std::ios::trunc);
+		if (!file.is_open()) {
+			throw std::runtime_error("failed to open " + path + "!");
+		}
+
+		file << std::fixed << std::setprecision(3);
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << GPU_THREAD << ",\"args\":{\"name\":\"GPU\"}}";
+		for (uint32_t i = 0; i < threadIndices.size(); i++) {
+			file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i + 1 << ",\"args\":{\"name\":\"" << (i == 0 ? "main" : "worker " + std::to_string(i)) << "\"}}";
+		}
+		for (const auto& event : events) {
+			file << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"" << (event.thread == GPU_THREAD ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+				<< ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}";
+		}
+		file << "\n]}\n";
+
+		if (!file) {
+			throw std::runtime_error("failed to write " + path + "!");
+		}
+
+		std::cout << "wrote " << events.size() << " trace events to " << path << std::endl;
+	}
+
+private:
+	static const uint32_t GPU_THREAD = 0;
+
+	struct FrameQueries {
+		VkQueryPool queryPool = VK_NULL_HANDLE;
+		std::vector<const char*> scopes;
+		double submitTime = 0.0;
+		double gpuFrameMs = -1.0;
+	};
+
+	struct TraceEvent {
+		const char* name;
+		uint32_t thread;
+		double start;
+		double duration;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	bool enabled = false;
+	bool gpuEnabled = false;
+	float timestampPeriod = 1.0f;
+	uint64_t timestampMask = ~0ull;
+
+	std::vector<FrameQueries> frames;
+	uint32_t currentFrame = 0;
+	double gpuTimelineEnd = 0.0;
+
+	std::chrono::high_resolution_clock::time_point startTime;
+
+	mutable std::mutex mutex;
+	std::vector<TraceEvent> events;
+	uint64_t droppedEvents = 0;
+	std::map<std::string, ProfileScopeStats> cpuStats;
+	std::map<std::string, ProfileScopeStats> gpuStats;
+	std::unordered_map<std::thread::id, uint32_t> threadIndices;
+
+	double now() const {
+		return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - startTime).count();
+	}
+
+	uint32_t getThreadIndex() {
+		auto it = threadIndices.find(std::this_thread::get_id());
+		if (it == threadIndices.end()) {
+			it = threadIndices.emplace(std::this_thread::get_id(), static_cast<uint32_t>(threadIndices.size()) + 1).first;
+		}
+		return it->second;
+	}
+
+	void addEvent(std::map<std::string, ProfileScopeStats>& stats, const char* name, uint32_t thread, double startUs, double durationUs) {
+		ProfileScopeStats& scope = stats[name];
+		scope.totalUs += durationUs;
+		scope.maxUs = std::max(scope.maxUs, durationUs);
+		scope.count++;
+
+		if (events.size() < PROFILER_MAX_TRACE_EVENTS) {
+			events.push_back({ name, thread, startUs, durationUs });
+		}
+		else {
+			droppedEvents++;
+		}
+	}
+
+	void collect(FrameQueries& frame) {
+		frame.gpuFrameMs = -1.0;
+		if (frame.scopes.empty()) {
+			return;
+		}
+
+		uint32_t queryCount = static_cast<uint32_t>(frame.scopes.size()) * 2;
+		std::vector<uint64_t> timestamps(queryCount);
+		if (vkGetQueryPoolResults(device, frame.queryPool, 0, queryCount, sizeof(uint64_t) * queryCount, timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+			return;
+		}
+
+		// Offsets from the first timestamp, masked so counters that wrap within
+		// their valid bits still give the right differences.
+		uint64_t base = timestamps[0];
+		frame.gpuFrameMs = ((timestamps[1] - base) & timestampMask) * timestampPeriod / 1000000.0;
+		if (!enabled) {
+			return;
+		}
+
+		double frameStart = std::max(frame.submitTime, gpuTimelineEnd);
+		double frameEnd = frameStart;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		for (size_t i = 0; i < frame.scopes.size(); i++) {
+			double beginUs = ((timestamps[i * 2] - base) & timestampMask) * timestampPeriod / 1000.0;
+			double endUs = ((timestamps[i * 2 + 1] - base) & timestampMask) * timestampPeriod / 1000.0;
+
+			addEvent(gpuStats, frame.scopes[i], GPU_THREAD, frameStart + beginUs, endUs - beginUs);
+			frameEnd = std::max(frameEnd, frameStart + endUs);
+		}
+		gpuTimelineEnd = frameEnd;
+	}
+
+	static void printStats(const char* kind, const std::map<std::string, ProfileScopeStats>& stats) {
+		for (const auto& entry : stats) {
+			const ProfileScopeStats& scope = entry.second;
+			std::cout << "  " << kind << " " << std::left << std::setw(16) << entry.first << std::right << " avg " << scope.totalUs / scope.count / 1000.0
+				<< " ms, max " << scope.maxUs / 1000.0 << " ms over " << scope.count << " samples" << std::endl;
+		}
+	}
+};
+
+inline CpuScope::CpuScope(Profiler* profiler, const char* name) : profiler(profiler), name(name) {
+	if (profiler) {
+		start = std::chrono::high_resolution_clock::now();
+	}
+}
+
+inline CpuScope::~CpuScope() {
+	if (profiler) {
+		profiler->addCpuEvent(name, start, std::chrono::high_resolution_clock::now());
+	}
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <stdexcept>
+#include <cstdint>
+
+#include "MemoryAllocator.h"
+
+const VkDeviceSize DEFAULT_STAGING_RING_SIZE = 16ull * 1024 * 1024;
+const VkDeviceSize STAGING_ALIGNMENT = 16;
+
+struct StagingRegion {
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	void* mapped = nullptr;
+};
+
+// Persistently mapped staging buffer that is carved up front to back and wraps
+// around. Positions are tracked as ever-increasing virtual offsets so a full ring
+// and an empty ring can be told apart; the owner hands the head position of each
+// submission back through release() once its fence has signaled.
+class StagingRing {
+public:
+	void init(VkDevice device, DeviceMemoryAllocator* allocator, VkDeviceSize capacity = DEFAULT_STAGING_RING_SIZE) {
+		this->device = device;
+		this->allocator = allocator;
+		this->capacity = capacity;
+
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = capacity;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create staging ring buffer!");
+		}
+
+		VkMemoryRequirements memRequirements;
+		vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+		uint32_t memoryType = allocator->findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		allocation = allocator->allocate(memRequirements, memoryType, true);
+		vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
+	}
+
+	void cleanup() {
+		vkDestroyBuffer(device, buffer, nullptr);
+		allocator->free(allocation);
+	}
+
+	bool allocate(VkDeviceSize size, StagingRegion& region) {
+		if (size > capacity) {
+			return false;
+		}
+
+		uint64_t position = alignUp(head, STAGING_ALIGNMENT);
+		if (position % capacity + size > capacity) {
+			position = (position / capacity + 1) * capacity;
+		}
+
+		if (position + size - tail > capacity) {
+			return false;
+		}
+
+		head = position + size;
+		bytesStagedThisFrame += size;
+		bytesStagedTotal += size;
+
+		region.buffer = buffer;
+		region.offset = position % capacity;
+		region.mapped = static_cast<char*>(allocation.mapped) + region.offset;
+		return true;
+	}
+
+	void release(uint64_t position) {
+		tail = position;
+	}
+
+	void beginFrame() {
+		bytesStagedThisFrame = 0;
+	}
+
+	uint64_t getHead() const { return head; }
+	VkDeviceSize getCapacity() const { return capacity; }
+	VkDeviceSize getBytesStagedThisFrame() const { return bytesStagedThisFrame; }
+	VkDeviceSize getBytesStagedTotal() const { return bytesStagedTotal; }
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	DeviceMemoryAllocator* allocator = nullptr;
+
+	VkBuffer buffer = VK_NULL_HANDLE;
+	Allocation allocation;
+	VkDeviceSize capacity = 0;
+
+	uint64_t head = 0;
+	uint64_t tail = 0;
+
+	VkDeviceSize bytesStagedThisFrame = 0;
+	VkDeviceSize bytesStagedTotal = 0;
+};
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <stb_image.h>
+
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+#include "MemoryAllocator.h"
+#include "UploadManager.h"
+#include "ThreadPool.h"
+
+const VkDeviceSize TEXTURE_LOADER_BATCH_SIZE = 8ull * 1024 * 1024;
+
+struct LoadedTexture {
+	VkImage image = VK_NULL_HANDLE;
+	Allocation allocation;
+	uint32_t width = 0;
+	uint32_t height = 0;
+};
+
+// Decodes images on the thread pool and copies the pixels straight into staging
+// memory reserved from the upload manager; the calling thread records the image
+// copies as decodes finish and submits them in batches.
+//
+// Every upload manager call happens under one mutex. A batch is only submitted
+// once no worker is still writing into staging space and every finished decode
+// has been recorded, so no staging region is released before its copy runs.
+class TextureLoader {
+public:
+	void init(ThreadPool* threadPool, UploadManager* uploadManager) {
+		this->threadPool = threadPool;
+		this->uploadManager = uploadManager;
+	}
+
+	// Loads every path as an RGBA8 image with a single mip level. createImage is
+	// called on the calling thread for each decoded image. The last batch is left
+	// unsubmitted so the caller's next submit() covers it.
+	std::vector<LoadedTexture> load(const std::vector<std::string>& paths, uint32_t workerCount,
+		const std::function<void(uint32_t width, uint32_t height, VkImage& image, Allocation& allocation)>& createImage) {
+		std::vector<LoadedTexture> textures(paths.size());
+		if (paths.empty()) {
+			return textures;
+		}
+
+		workerCount = std::min(std::min(std::max(workerCount, 1u), threadPool->getThreadCount()), static_cast<uint32_t>(paths.size()));
+
+		nextPath = 0;
+		remaining = static_cast<uint32_t>(paths.size());
+		writers = 0;
+		waitingForSpace = 0;
+		firstError = nullptr;
+
+		for (uint32_t i = 0; i < workerCount; i++) {
+			threadPool->submit([this, &paths]() { decodeLoop(paths); });
+		}
+
+		VkDeviceSize recordedBytes = 0;
+
+		std::unique_lock<std::mutex> lock(mutex);
+		while (remaining > 0) {
+			progress.wait(lock, [this]() { return !completed.empty() || remaining == 0 || (waitingForSpace > 0 && writers == 0); });
+
+			for (auto& decoded : completed) {
+				LoadedTexture& texture = textures[decoded.index];
+				texture.width = decoded.width;
+				texture.height = decoded.height;
+				createImage(texture.width, texture.height, texture.image, texture.allocation);
+
+				uploadManager->transitionImageLayout(texture.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+				uploadManager->copyBufferToImage(decoded.staging.buffer, decoded.staging.offset, texture.image, texture.width, texture.height);
+				uploadManager->transitionImageLayout(texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+				recordedBytes += static_cast<VkDeviceSize>(texture.width) * texture.height * 4;
+				remaining--;
+			}
+			completed.clear();
+
+			if (writers == 0 && (waitingForSpace > 0 || recordedBytes >= TEXTURE_LOADER_BATCH_SIZE)) {
+				uploadManager->submit();
+				recordedBytes = 0;
+
+				if (waitingForSpace > 0) {
+					uploadManager->retireOldestBatch();
+					waitingForSpace = 0;
+					spaceGeneration++;
+					spaceFreed.notify_all();
+				}
+				else {
+					uploadManager->collect();
+				}
+			}
+		}
+		lock.unlock();
+
+		threadPool->wait();
+
+		if (firstError) {
+			std::rethrow_exception(firstError);
+		}
+
+		return textures;
+	}
+
+private:
+	struct DecodedImage {
+		uint32_t index;
+		uint32_t width;
+		uint32_t height;
+		StagingRegion staging;
+	};
+
+	ThreadPool* threadPool = nullptr;
+	UploadManager* uploadManager = nullptr;
+
+	std::atomic<uint32_t> nextPath{ 0 };
+
+	std::mutex mutex;
+	std::condition_variable progress;
+	std::condition_variable spaceFreed;
+	std::vector<DecodedImage> completed;
+	uint32_t remaining = 0;
+	uint32_t writers = 0;
+	uint32_t waitingForSpace = 0;
+	uint64_t spaceGeneration = 0;
+	std::exception_ptr firstError;
+
+	void decodeLoop(const std::vector<std::string>& paths) {
+		for (uint32_t index = nextPath++; index < paths.size(); index = nextPath++) {
+			try {
+				decode(index, paths[index]);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(mutex);
+				if (!firstError) {
+					firstError = std::current_exception();
+				}
+				remaining--;
+				progress.notify_one();
+			}
+		}
+	}
+
+	void decode(uint32_t index, const std::string& path) {
+		int texWidth, texHeight, texChannels;
+		stbi_uc* pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+
+		if (!pixels) {
+			throw std::runtime_error("failed to load texture image " + path + "!");
+		}
+
+		DecodedImage decoded{};
+		decoded.index = index;
+		decoded.width = static_cast<uint32_t>(texWidth);
+		decoded.height = static_cast<uint32_t>(texHeight);
+		VkDeviceSize imageSize = static_cast<VkDeviceSize>(decoded.width) * decoded.height * 4;
+
+		std::unique_lock<std::mutex> lock(mutex);
+		while (!uploadManager->tryReserve(imageSize, decoded.staging)) {
+			uint64_t generation = spaceGeneration;
+			waitingForSpace++;
+			progress.notify_one();
+			spaceFreed.wait(lock, [this, generation]() { return spaceGeneration != generation; });
+		}
+		writers++;
+		lock.unlock();
+
+		memcpy(decoded.staging.mapped, pixels, static_cast<size_t>(imageSize));
+		stbi_image_free(pixels);
+
+		lock.lock();
+		writers--;
+		completed.push_back(decoded);
+		progress.notify_one();
+	}
+};
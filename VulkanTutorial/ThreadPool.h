@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+// Fixed set of worker threads pulling jobs from a shared queue. wait() blocks
+// until every submitted job has finished and rethrows the first exception a
+// job raised.
+class ThreadPool {
+public:
+	void init(uint32_t threadCount) {
+		threadCount = std::max(threadCount, 1u);
+
+		stopping = false;
+		for (uint32_t i = 0; i < threadCount; i++) {
+			workers.emplace_back([this]() { workerLoop(); });
+		}
+	}
+
+	void cleanup() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		jobAvailable.notify_all();
+
+		for (auto& worker : workers) {
+			worker.join();
+		}
+		workers.clear();
+	}
+
+	void submit(std::function<void()> job) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back(std::move(job));
+			activeJobs++;
+		}
+		jobAvailable.notify_one();
+	}
+
+	void wait() {
+		std::unique_lock<std::mutex> lock(mutex);
+		jobsDone.wait(lock, [this]() { return activeJobs == 0; });
+
+		if (firstError) {
+			std::exception_ptr error = firstError;
+			firstError = nullptr;
+			std::rethrow_exception(error);
+		}
+	}
+
+	// Splits [0, count) into at most chunkCount contiguous ranges, runs one job
+	// per range and waits for all of them. Chunk indices are dense and unique, so
+	// callers can use them to pick per-thread resources.
+	void parallelFor(uint32_t count, uint32_t chunkCount, const std::function<void(uint32_t chunk, uint32_t begin, uint32_t end)>& body) {
+		chunkCount = std::min(chunkCount, count);
+
+		for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+			uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(count) * chunk / chunkCount);
+			uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(count) * (chunk + 1) / chunkCount);
+			submit([&body, chunk, begin, end]() { body(chunk, begin, end); });
+		}
+
+		wait();
+	}
+
+	uint32_t getThreadCount() const {
+		return static_cast<uint32_t>(workers.size());
+	}
+
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	std::condition_variable jobsDone;
+	uint32_t activeJobs = 0;
+	bool stopping = false;
+	std::exception_ptr firstError;
+
+	void workerLoop() {
+		while (true) {
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				jobAvailable.wait(lock, [this]() { return stopping || !jobs.empty(); });
+
+				if (jobs.empty()) {
+					return;
+				}
+
+				job = std::move(jobs.front());
+				jobs.pop_front();
+			}
+
+			std::exception_ptr error;
+			try {
+				job();
+			}
+			catch (...) {
+				error = std::current_exception();
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (error && !firstError) {
+					firstError = error;
+				}
+				activeJobs--;
+			}
+			jobsDone.notify_all();
+		}
+	}
+};
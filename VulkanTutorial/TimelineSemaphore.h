@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <stdexcept>
+#include <cstdint>
+
+// A timeline semaphore plus the last value it was seen to reach. Values only
+// ever increase, so once a value has been observed complete every check against
+// it or anything below it is answered without calling into the driver.
+class TimelineSemaphore {
+public:
+	void init(VkDevice device, uint64_t initialValue = 0) {
+		this->device = device;
+
+		VkSemaphoreTypeCreateInfo typeInfo{};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		typeInfo.initialValue = initialValue;
+
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &typeInfo;
+
+		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create timeline semaphore!");
+		}
+
+		completedValue = initialValue;
+	}
+
+	void cleanup() {
+		vkDestroySemaphore(device, semaphore, nullptr);
+		semaphore = VK_NULL_HANDLE;
+	}
+
+	VkSemaphore getHandle() const {
+		return semaphore;
+	}
+
+	uint64_t getCompletedValue() {
+		uint64_t value;
+		if (vkGetSemaphoreCounterValue(device, semaphore, &value) != VK_SUCCESS) {
+			throw std::runtime_error("failed to query timeline semaphore!");
+		}
+
+		completedValue = value;
+		return completedValue;
+	}
+
+	bool isComplete(uint64_t value) {
+		return value <= completedValue || value <= getCompletedValue();
+	}
+
+	void wait(uint64_t value) {
+		if (value <= completedValue) {
+			return;
+		}
+
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &semaphore;
+		waitInfo.pValues = &value;
+
+		if (vkWaitSemaphores(device, &waitInfo, UINT64_MAX) != VK_SUCCESS) {
+			throw std::runtime_error("failed to wait for timeline semaphore!");
+		}
+
+		completedValue = value;
+	}
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkSemaphore semaphore = VK_NULL_HANDLE;
+	uint64_t completedValue = 0;
+};
@@ -0,0 +1,458 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <stdexcept>
+#include <vector>
+#include <deque>
+#include <cstring>
+
+#include "MemoryAllocator.h"
+#include "StagingRing.h"
+#include "CompressedTexture.h"
+#include "TimelineSemaphore.h"
+
+// Records any number of buffer/image uploads into a single command buffer and
+// submits them as one batch. Each batch signals the next value on one timeline
+// semaphore, so the CPU never waits and GPU consumers wait on the value returned
+// by submit(). Source data is staged through a persistent ring whose space is
+// handed back as the timeline passes each batch; only uploads larger than the
+// whole ring get their own staging buffer.
+class UploadManager {
+public:
+	void init(VkDevice device, DeviceMemoryAllocator* allocator, uint32_t queueFamilyIndex, VkQueue queue, bool graphicsCapable) {
+		this->device = device;
+		this->allocator = allocator;
+		this->queue = queue;
+		this->graphicsCapable = graphicsCapable;
+
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		poolInfo.queueFamilyIndex = queueFamilyIndex;
+
+		if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create upload command pool!");
+		}
+
+		stagingRing.init(device, allocator);
+		timeline.init(device);
+	}
+
+	void cleanup() {
+		waitIdle();
+
+		freeBatches.clear();
+
+		if (recording) {
+			releaseStagingBuffers(current);
+			recording = false;
+		}
+
+		vkDestroyCommandPool(device, commandPool, nullptr);
+
+		timeline.cleanup();
+		stagingRing.cleanup();
+	}
+
+	bool isGraphicsCapable() const {
+		return graphicsCapable;
+	}
+
+	void uploadBuffer(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0) {
+		StagingRegion staging = stage(data, size);
+
+		VkBufferCopy copyRegion{};
+		copyRegion.srcOffset = staging.offset;
+		copyRegion.dstOffset = dstOffset;
+		copyRegion.size = size;
+		vkCmdCopyBuffer(getCommandBuffer(), staging.buffer, dstBuffer, 1, &copyRegion);
+	}
+
+	void uploadImage(VkImage image, const void* data, VkDeviceSize size, uint32_t width, uint32_t height, uint32_t mipLevel = 0) {
+		StagingRegion staging = stage(data, size);
+
+		transitionImageLayout(image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevel);
+		copyBufferToImage(staging.buffer, staging.offset, image, width, height, mipLevel);
+		transitionImageLayout(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevel);
+	}
+
+	// Uploads level 0 and blits it down the rest of the chain. Blits need a
+	// graphics queue and a format with linear filtering support.
+	void uploadImageWithMipmaps(VkImage image, const void* data, VkDeviceSize size, uint32_t width, uint32_t height, uint32_t mipLevels) {
+		if (!graphicsCapable) {
+			throw std::runtime_error("mipmap generation requires a graphics-capable upload queue!");
+		}
+
+		StagingRegion staging = stage(data, size);
+
+		transitionImageLayout(image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, mipLevels);
+		copyBufferToImage(staging.buffer, staging.offset, image, width, height);
+
+		VkCommandBuffer commandBuffer = getCommandBuffer();
+
+		int32_t mipWidth = static_cast<int32_t>(width);
+		int32_t mipHeight = static_cast<int32_t>(height);
+
+		for (uint32_t i = 1; i < mipLevels; i++) {
+			transitionImageLayout(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, i - 1);
+
+			VkImageBlit blit{};
+			blit.srcOffsets[0] = { 0, 0, 0 };
+			blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+			blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.srcSubresource.mipLevel = i - 1;
+			blit.srcSubresource.baseArrayLayer = 0;
+			blit.srcSubresource.layerCount = 1;
+			blit.dstOffsets[0] = { 0, 0, 0 };
+			blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
+			blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.dstSubresource.mipLevel = i;
+			blit.dstSubresource.baseArrayLayer = 0;
+			blit.dstSubresource.layerCount = 1;
+
+			vkCmdBlitImage(commandBuffer,
+				image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				1, &blit,
+				VK_FILTER_LINEAR);
+
+			transitionImageLayout(image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, i - 1);
+
+			if (mipWidth > 1) mipWidth /= 2;
+			if (mipHeight > 1) mipHeight /= 2;
+		}
+
+		transitionImageLayout(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels - 1);
+	}
+
+	// Uploads every level of a block-compressed texture from one staging region,
+	// packing the levels back to back. Level sizes are whole blocks, so each
+	// level's offset keeps the block alignment vkCmdCopyBufferToImage requires.
+	void uploadCompressedImage(VkImage image, const CompressedTexture& texture) {
+		uint32_t mipLevels = static_cast<uint32_t>(texture.levels.size());
+		StagingRegion staging = reserve(texture.getDataSize());
+
+		transitionImageLayout(image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, mipLevels);
+
+		VkDeviceSize offset = 0;
+		for (uint32_t level = 0; level < mipLevels; level++) {
+			const CompressedMipLevel& mip = texture.levels[level];
+			memcpy(static_cast<char*>(staging.mapped) + offset, texture.getData() + mip.offset, static_cast<size_t>(mip.size));
+			copyBufferToImage(staging.buffer, staging.offset + offset, image, mip.width, mip.height, level);
+			offset += mip.size;
+		}
+
+		transitionImageLayout(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, mipLevels);
+	}
+
+	StagingRegion stage(const void* data, VkDeviceSize size) {
+		StagingRegion staging = reserve(size);
+		memcpy(staging.mapped, data, static_cast<size_t>(size));
+		return staging;
+	}
+
+	// Hands out mapped staging memory owned by the batch currently being recorded,
+	// for callers that want to write their data in place.
+	StagingRegion reserve(VkDeviceSize size) {
+		StagingRegion staging;
+		while (!tryReserve(size, staging)) {
+			// The ring is full of data the current batch still needs, so flush it
+			// early. Waiting on any later value covers it as well.
+			if (pendingBatches.empty()) {
+				submit();
+			}
+
+			retireOldestBatch();
+		}
+
+		return staging;
+	}
+
+	// Like reserve(), but returns false instead of flushing when the ring is
+	// full. Callers that still have unrecorded copies out of the current batch
+	// use this, since flushing would hand their staging space back too early.
+	bool tryReserve(VkDeviceSize size, StagingRegion& staging) {
+		if (size > stagingRing.getCapacity()) {
+			getCommandBuffer();
+			staging = createStagingBuffer(size);
+			return true;
+		}
+
+		if (!stagingRing.allocate(size, staging)) {
+			return false;
+		}
+
+		getCommandBuffer();
+		return true;
+	}
+
+	// Blocks until the oldest submitted batch completes and releases its staging
+	// space. Returns false when nothing is in flight.
+	bool retireOldestBatch() {
+		if (pendingBatches.empty()) {
+			return false;
+		}
+
+		timeline.wait(pendingBatches.front().value);
+		retireBatch();
+		return true;
+	}
+
+	void transitionImageLayout(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t baseMipLevel = 0, uint32_t levelCount = 1) {
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = baseMipLevel;
+		barrier.subresourceRange.levelCount = levelCount;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+
+		VkPipelineStageFlags sourceStage;
+		VkPipelineStageFlags destinationStage;
+
+		if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+			sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+			destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		}
+		else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+			sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+			destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		}
+		else if ((oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL || oldLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+			barrier.srcAccessMask = oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL ? VK_ACCESS_TRANSFER_WRITE_BIT : VK_ACCESS_TRANSFER_READ_BIT;
+
+			sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+			if (graphicsCapable) {
+				barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+				destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			}
+			else {
+				// Transfer-only queues cannot name shader stages; the semaphore the
+				// graphics submission waits on makes the writes visible instead.
+				barrier.dstAccessMask = 0;
+				destinationStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+			}
+		}
+		else {
+			throw std::invalid_argument("unsupported layout transition!");
+		}
+
+		vkCmdPipelineBarrier(
+			getCommandBuffer(),
+			sourceStage, destinationStage,
+			0,
+			0, nullptr,
+			0, nullptr,
+			1, &barrier
+		);
+	}
+
+	void copyBufferToImage(VkBuffer buffer, VkDeviceSize bufferOffset, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevel = 0) {
+		VkBufferImageCopy region{};
+		region.bufferOffset = bufferOffset;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = mipLevel;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = {
+			width,
+			height,
+			1
+		};
+
+		vkCmdCopyBufferToImage(getCommandBuffer(), buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+	}
+
+	VkCommandBuffer getCommandBuffer() {
+		if (!recording) {
+			beginBatch();
+		}
+
+		return current.commandBuffer;
+	}
+
+	// Submits everything recorded since the last call. Returns the timeline value
+	// the batch signals when it completes, or 0 when nothing was recorded.
+	uint64_t submit() {
+		if (!recording) {
+			return 0;
+		}
+
+		if (vkEndCommandBuffer(current.commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record upload command buffer!");
+		}
+
+		current.value = ++lastSubmittedValue;
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.signalSemaphoreValueCount = 1;
+		timelineInfo.pSignalSemaphoreValues = &current.value;
+
+		VkSemaphore semaphore = timeline.getHandle();
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &timelineInfo;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &current.commandBuffer;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &semaphore;
+
+		if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+			throw std::runtime_error("failed to submit upload command buffer!");
+		}
+
+		current.ringEnd = stagingRing.getHead();
+		pendingBatches.push_back(std::move(current));
+		current = Batch{};
+		recording = false;
+
+		return lastSubmittedValue;
+	}
+
+	void collect() {
+		while (!pendingBatches.empty() && timeline.isComplete(pendingBatches.front().value)) {
+			retireBatch();
+		}
+	}
+
+	void waitIdle() {
+		if (pendingBatches.empty()) {
+			return;
+		}
+
+		timeline.wait(pendingBatches.back().value);
+		while (!pendingBatches.empty()) {
+			retireBatch();
+		}
+	}
+
+	VkSemaphore getTimelineSemaphore() const {
+		return timeline.getHandle();
+	}
+
+	void beginFrame() {
+		stagingRing.beginFrame();
+	}
+
+	const StagingRing& getStagingRing() const {
+		return stagingRing;
+	}
+
+private:
+	struct StagingBuffer {
+		VkBuffer buffer;
+		Allocation allocation;
+	};
+
+	struct Batch {
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		uint64_t value = 0;
+		uint64_t ringEnd = 0;
+		std::vector<StagingBuffer> stagingBuffers;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	DeviceMemoryAllocator* allocator = nullptr;
+	VkQueue queue = VK_NULL_HANDLE;
+	bool graphicsCapable = false;
+
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	StagingRing stagingRing;
+	TimelineSemaphore timeline;
+	uint64_t lastSubmittedValue = 0;
+
+	Batch current;
+	bool recording = false;
+	std::deque<Batch> pendingBatches;
+	std::vector<Batch> freeBatches;
+
+	void beginBatch() {
+		if (!freeBatches.empty()) {
+			current = std::move(freeBatches.back());
+			freeBatches.pop_back();
+
+			vkResetCommandBuffer(current.commandBuffer, 0);
+		}
+		else {
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandPool = commandPool;
+			allocInfo.commandBufferCount = 1;
+
+			if (vkAllocateCommandBuffers(device, &allocInfo, &current.commandBuffer) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate upload command buffer!");
+			}
+		}
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		vkBeginCommandBuffer(current.commandBuffer, &beginInfo);
+		recording = true;
+	}
+
+	void retireBatch() {
+		Batch batch = std::move(pendingBatches.front());
+		pendingBatches.pop_front();
+
+		stagingRing.release(batch.ringEnd);
+		releaseStagingBuffers(batch);
+		freeBatches.push_back(std::move(batch));
+	}
+
+	StagingRegion createStagingBuffer(VkDeviceSize size) {
+		StagingBuffer staging{};
+
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = size;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateBuffer(device, &bufferInfo, nullptr, &staging.buffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create staging buffer!");
+		}
+
+		VkMemoryRequirements memRequirements;
+		vkGetBufferMemoryRequirements(device, staging.buffer, &memRequirements);
+
+		uint32_t memoryType = allocator->findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		staging.allocation = allocator->allocate(memRequirements, memoryType, true);
+		vkBindBufferMemory(device, staging.buffer, staging.allocation.memory, staging.allocation.offset);
+
+		current.stagingBuffers.push_back(staging);
+
+		StagingRegion region;
+		region.buffer = staging.buffer;
+		region.offset = 0;
+		region.mapped = staging.allocation.mapped;
+		return region;
+	}
+
+	void releaseStagingBuffers(Batch& batch) {
+		for (auto& staging : batch.stagingBuffers) {
+			vkDestroyBuffer(device, staging.buffer, nullptr);
+			allocator->free(staging.allocation);
+		}
+		batch.stagingBuffers.clear();
+	}
+};
@@ -0,0 +1,284 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <stdexcept>
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <cstdint>
+
+// Attribute encodings. Each one is exactly the bytes the GPU fetches for its
+// VkFormat, so a vertex is a plain struct of them with no padding.
+
+struct Float3 {
+	static constexpr VkFormat format = VK_FORMAT_R32G32B32_SFLOAT;
+	float value[3];
+
+	static Float3 encode(const glm::vec3& v) {
+		return { { v.x, v.y, v.z } };
+	}
+
+	glm::vec3 decode() const {
+		return glm::vec3(value[0], value[1], value[2]);
+	}
+};
+
+inline uint16_t floatToHalf(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+	int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xff) - 127 + 15;
+	uint32_t mantissa = bits & 0x7fffff;
+
+	if (exponent >= 31) {
+		bool isNan = ((bits >> 23) & 0xff) == 0xff && mantissa != 0;
+		return static_cast<uint16_t>(sign | 0x7c00 | (isNan ? 0x200 : 0));
+	}
+	if (exponent <= 0) {
+		if (exponent < -10) {
+			return sign;
+		}
+		// Denormal: shift in the implicit bit and round to nearest even.
+		mantissa |= 0x800000;
+		uint32_t shift = static_cast<uint32_t>(14 - exponent);
+		uint32_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1))) {
+			half++;
+		}
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+	uint32_t remainder = mantissa & 0x1fff;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+		half++; // may carry into the exponent, which rounds up to infinity correctly
+	}
+	return static_cast<uint16_t>(sign | half);
+}
+
+inline float halfToFloat(uint16_t half) {
+	uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+	uint32_t exponent = (half >> 10) & 0x1f;
+	uint32_t mantissa = half & 0x3ff;
+
+	float value;
+	if (exponent == 0) {
+		value = std::ldexp(static_cast<float>(mantissa), -24);
+	}
+	else if (exponent == 31) {
+		value = mantissa == 0 ? INFINITY : NAN;
+	}
+	else {
+		value = std::ldexp(static_cast<float>(mantissa | 0x400), static_cast<int>(exponent) - 25);
+	}
+
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	bits |= sign;
+	memcpy(&value, &bits, sizeof(bits));
+	return value;
+}
+
+// Three-component 16-bit formats are rarely supported for vertex fetch, so
+// half positions carry a fourth component (1.0) to stay at eight bytes.
+struct Half4 {
+	static constexpr VkFormat format = VK_FORMAT_R16G16B16A16_SFLOAT;
+	uint16_t value[4];
+
+	static Half4 encode(const glm::vec3& v) {
+		return { { floatToHalf(v.x), floatToHalf(v.y), floatToHalf(v.z), floatToHalf(1.0f) } };
+	}
+
+	glm::vec3 decode() const {
+		return glm::vec3(halfToFloat(value[0]), halfToFloat(value[1]), halfToFloat(value[2]));
+	}
+};
+
+inline int16_t floatToSnorm16(float value) {
+	return static_cast<int16_t>(std::lround(std::min(std::max(value, -1.0f), 1.0f) * 32767.0f));
+}
+
+inline float snorm16ToFloat(int16_t value) {
+	return std::max(value / 32767.0f, -1.0f);
+}
+
+struct Snorm16x4 {
+	static constexpr VkFormat format = VK_FORMAT_R16G16B16A16_SNORM;
+	int16_t value[4];
+
+	static Snorm16x4 encode(const glm::vec3& v) {
+		return { { floatToSnorm16(v.x), floatToSnorm16(v.y), floatToSnorm16(v.z), 0 } };
+	}
+
+	glm::vec3 decode() const {
+		return glm::vec3(snorm16ToFloat(value[0]), snorm16ToFloat(value[1]), snorm16ToFloat(value[2]));
+	}
+};
+
+// Unit vector folded onto the octahedron |x| + |y| + |z| = 1 and unwrapped
+// into the [-1, 1] square; decodeOctahedral() in shader.vert reverses it.
+inline glm::vec2 encodeOctahedral(const glm::vec3& n) {
+	float sum = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+	if (sum == 0.0f) {
+		return glm::vec2(0.0f, 0.0f);
+	}
+
+	glm::vec2 e(n.x / sum, n.y / sum);
+	if (n.z < 0.0f) {
+		glm::vec2 folded((1.0f - std::abs(e.y)) * (e.x >= 0.0f ? 1.0f : -1.0f), (1.0f - std::abs(e.x)) * (e.y >= 0.0f ? 1.0f : -1.0f));
+		e = folded;
+	}
+	return e;
+}
+
+inline glm::vec3 decodeOctahedral(const glm::vec2& e) {
+	glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+	float t = std::max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return glm::normalize(n);
+}
+
+struct OctahedralSnorm16x2 {
+	static constexpr VkFormat format = VK_FORMAT_R16G16_SNORM;
+	int16_t value[2];
+
+	static OctahedralSnorm16x2 encode(const glm::vec3& v) {
+		glm::vec2 e = encodeOctahedral(v);
+		return { { floatToSnorm16(e.x), floatToSnorm16(e.y) } };
+	}
+
+	glm::vec3 decode() const {
+		return decodeOctahedral(glm::vec2(snorm16ToFloat(value[0]), snorm16ToFloat(value[1])));
+	}
+};
+
+struct Unorm8x4 {
+	static constexpr VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+	uint8_t value[4];
+
+	static uint8_t toUnorm8(float value) {
+		return static_cast<uint8_t>(std::lround(std::min(std::max(value, 0.0f), 1.0f) * 255.0f));
+	}
+
+	static Unorm8x4 encode(const glm::vec3& v) {
+		return { { toUnorm8(v.x), toUnorm8(v.y), toUnorm8(v.z), 255 } };
+	}
+
+	glm::vec3 decode() const {
+		return glm::vec3(value[0] / 255.0f, value[1] / 255.0f, value[2] / 255.0f);
+	}
+};
+
+// A vertex made of one encoding per attribute. Locations are fixed (0 position,
+// 1 normal, 2 color) so every layout feeds the same shader inputs; the formats
+// and offsets come from the template arguments.
+template<typename Position, typename Normal, typename Color>
+struct VertexLayout {
+	Position position;
+	Normal normal;
+	Color color;
+
+	static constexpr uint32_t attributeCount = 3;
+	static constexpr uint32_t stride = sizeof(Position) + sizeof(Normal) + sizeof(Color);
+
+	static VertexLayout encode(const glm::vec3& position, const glm::vec3& normal, const glm::vec3& color) {
+		return { Position::encode(position), Normal::encode(normal), Color::encode(color) };
+	}
+
+	static constexpr VkVertexInputBindingDescription getBindingDescription(uint32_t binding) {
+		return { binding, stride, VK_VERTEX_INPUT_RATE_VERTEX };
+	}
+
+	static constexpr std::array<VkVertexInputAttributeDescription, attributeCount> getAttributeDescriptions(uint32_t binding) {
+		return { {
+			{ 0, binding, Position::format, static_cast<uint32_t>(offsetof(VertexLayout, position)) },
+			{ 1, binding, Normal::format, static_cast<uint32_t>(offsetof(VertexLayout, normal)) },
+			{ 2, binding, Color::format, static_cast<uint32_t>(offsetof(VertexLayout, color)) }
+		} };
+	}
+};
+
+using FloatVertex = VertexLayout<Float3, Float3, Float3>;
+using HalfVertex = VertexLayout<Half4, Snorm16x4, Unorm8x4>;
+using OctahedralVertex = VertexLayout<Half4, OctahedralSnorm16x2, Unorm8x4>;
+
+static_assert(sizeof(FloatVertex) == FloatVertex::stride, "FloatVertex must be tightly packed");
+static_assert(sizeof(HalfVertex) == HalfVertex::stride, "HalfVertex must be tightly packed");
+static_assert(sizeof(OctahedralVertex) == OctahedralVertex::stride, "OctahedralVertex must be tightly packed");
+
+// Stored in mesh files, so values must not change.
+enum class VertexFormat : uint32_t {
+	Float = 0,
+	Half = 1,
+	Octahedral = 2
+};
+
+const std::array<VertexFormat, 3> ALL_VERTEX_FORMATS = { VertexFormat::Float, VertexFormat::Half, VertexFormat::Octahedral };
+
+inline const char* getVertexFormatName(VertexFormat format) {
+	switch (format) {
+	case VertexFormat::Float:
+		return "float";
+	case VertexFormat::Half:
+		return "half";
+	case VertexFormat::Octahedral:
+		return "octahedral";
+	}
+	return "unknown";
+}
+
+inline VertexFormat parseVertexFormat(const std::string& name) {
+	for (VertexFormat format : ALL_VERTEX_FORMATS) {
+		if (name == getVertexFormatName(format)) {
+			return format;
+		}
+	}
+	throw std::runtime_error("unknown vertex format: " + name);
+}
+
+inline bool isValidVertexFormat(uint32_t format) {
+	return format <= static_cast<uint32_t>(VertexFormat::Octahedral);
+}
+
+// Calls visitor with a value-initialized vertex of the layout behind format, so
+// runtime-selected formats can reach the compile-time layouts.
+template<typename Visitor>
+auto visitVertexFormat(VertexFormat format, Visitor&& visitor) {
+	switch (format) {
+	case VertexFormat::Half:
+		return visitor(HalfVertex{});
+	case VertexFormat::Octahedral:
+		return visitor(OctahedralVertex{});
+	default:
+		return visitor(FloatVertex{});
+	}
+}
+
+inline uint32_t getVertexStride(VertexFormat format) {
+	return visitVertexFormat(format, [](auto vertex) { return decltype(vertex)::stride; });
+}
+
+template<typename Source>
+std::vector<char> encodeVertices(VertexFormat format, const std::vector<Source>& vertices) {
+	return visitVertexFormat(format, [&](auto vertex) {
+		using Layout = decltype(vertex);
+
+		std::vector<char> encoded(vertices.size() * sizeof(Layout));
+		Layout* out = reinterpret_cast<Layout*>(encoded.data());
+		for (size_t i = 0; i < vertices.size(); i++) {
+			out[i] = Layout::encode(vertices[i].pos, vertices[i].normal, vertices[i].color);
+		}
+		return encoded;
+	});
+}
@@ -3,12 +3,17 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
 
 #include <iostream>
 #include <fstream>
+#include <iomanip>
 #include <stdexcept>
 #include <algorithm>
 #include <chrono>
@@ -16,15 +21,62 @@
 #include <cstring>
 #include <cstdlib>
 #include <cstdint>
+#include <cmath>
 #include <limits>
 #include <array>
 #include <optional>
 #include <set>
+#include <string>
+#include <unordered_map>
+
+#include "MemoryAllocator.h"
+#include "UploadManager.h"
+#include "ThreadPool.h"
+#include "ParallelRecorder.h"
+#include "PipelineCache.h"
+#include "PipelineRegistry.h"
+#include "Mipmaps.h"
+#include "CompressedTexture.h"
+#include "TextureLoader.h"
+#include "AssetPack.h"
+#include "Mesh.h"
+#include "VertexLayout.h"
+#include "FrameReadback.h"
+#include "Profiler.h"
+#include "FrameStats.h"
+#include "FrameScheduler.h"
+#include "BindlessTable.h"
+#include "DescriptorAllocator.h"
+#include "DeletionQueue.h"
 
 const uint32_t WIDTH = 800;
 const uint32_t HEIGHT = 600;
 
-const int MAX_FRAMES_IN_FLIGHT = 2;
+const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+const uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+// Sets in each frame slot's first descriptor pool. A frame needs two; further
+// pools are chained on demand.
+const uint32_t DESCRIPTOR_POOL_INITIAL_SETS = 8;
+
+const VkFormat HEADLESS_COLOR_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+const uint32_t HEADLESS_DEFAULT_FRAME_COUNT = 300;
+const float HEADLESS_FRAME_TIME = 1.0f / 60.0f;
+
+// Readback slots beyond the frames in flight, which is how many finished frames
+// the writer thread can fall behind by before frames start being dropped.
+const uint32_t READBACK_QUEUE_DEPTH = 3;
+
+const double FRAME_STATS_REPORT_INTERVAL_MS = 500.0;
+
+const std::string PIPELINE_CACHE_FILE = "pipeline_cache.bin";
+
+const std::string ASSET_PACK_PATH = "assets.pack";
+
+const std::string TEXTURE_PATH = "textures/texture.jpg";
+const std::string COMPRESSED_TEXTURE_PATH = "textures/texture.ktx2";
+
+const uint32_t TEXTURE_STREAM_INITIAL_EXTENT = 128;
 
 const std::vector<const char*> validationLayers = {
 	"VK_LAYER_KHRONOS_validation"
@@ -40,6 +92,285 @@ const bool enableValidationLayers = false;
 const bool enableValidationLayers = true;
 #endif
 
+const uint32_t BENCHMARK_UPLOAD_COUNT = 1000;
+const VkDeviceSize BENCHMARK_UPLOAD_SIZE = 64 * 1024;
+
+const uint32_t CULL_WORKGROUP_SIZE = 64;
+
+const uint32_t BENCHMARK_DRAW_COUNT = 100000;
+const uint32_t BENCHMARK_RECORDING_ITERATIONS = 10;
+
+const uint32_t BENCHMARK_TEXTURE_COUNT = 500;
+
+const uint32_t BENCHMARK_VERTEX_COUNT = 1000000;
+
+const std::string BENCHMARK_REPORT_PATH = "benchmark.json";
+const uint32_t SCENE_TEXTURE_EXTENT = 256;
+const uint32_t MAX_PIPELINE_VARIANTS = 24;
+
+struct AppOptions {
+	bool benchmarkUploads = false;
+	bool benchmarkRecording = false;
+	uint32_t recordThreads = 0;
+	uint32_t instanceCount = 1;
+	bool verifyCulling = false;
+	bool verifyPipelines = false;
+	bool compareTextureFormats = false;
+	bool benchmarkTextureLoading = false;
+	bool benchmarkVertexFormats = false;
+	std::string meshPath;
+	VertexFormat vertexFormat = VertexFormat::Half;
+	bool headless = false;
+	uint32_t frameCount = 0;
+	VkExtent2D headlessExtent = { WIDTH, HEIGHT };
+	std::string outputPath;
+	std::optional<FrameFormat> outputFormat;
+	bool profile = false;
+	std::string tracePath;
+	bool stats = false;
+	std::string statsCsvPath;
+	std::string sceneName;
+	uint32_t drawCount = 1;
+	uint32_t sceneTextureCount = 0;
+	uint32_t pipelineVariantCount = 1;
+	uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+	std::string jsonPath;
+};
+
+VkExtent2D parseExtent(const std::string& size) {
+	size_t separator = size.find('x');
+	if (separator == std::string::npos) {
+		throw std::runtime_error("expected WIDTHxHEIGHT, got " + size);
+	}
+	return { static_cast<uint32_t>(std::stoul(size.substr(0, separator))), static_cast<uint32_t>(std::stoul(size.substr(separator + 1))) };
+}
+
+// Scene files are "key = value" lines with '#' comments. They set the same
+// options as the command line, so flags after --scene override them.
+void applySceneFile(AppOptions& options, const std::string& path) {
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		throw std::runtime_error("failed to open scene " + path + "!");
+	}
+
+	size_t slash = path.find_last_of("/\\");
+	options.sceneName = path.substr(slash == std::string::npos ? 0 : slash + 1);
+	options.sceneName = options.sceneName.substr(0, options.sceneName.find_last_of('.'));
+
+	std::string line;
+	uint32_t lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		line = line.substr(0, line.find('#'));
+		if (line.find_first_not_of(" \t\r") == std::string::npos) {
+			continue;
+		}
+
+		size_t equals = line.find('=');
+		if (equals == std::string::npos) {
+			throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": expected key = value");
+		}
+
+		auto trim = [](const std::string& text) {
+			size_t begin = text.find_first_not_of(" \t\r");
+			size_t end = text.find_last_not_of(" \t\r");
+			return begin == std::string::npos ? std::string() : text.substr(begin, end - begin + 1);
+		};
+		std::string key = trim(line.substr(0, equals));
+		std::string value = trim(line.substr(equals + 1));
+
+		if (key == "objects") {
+			options.instanceCount = static_cast<uint32_t>(std::stoul(value));
+		}
+		else if (key == "draws") {
+			options.drawCount = static_cast<uint32_t>(std::stoul(value));
+		}
+		else if (key == "textures") {
+			options.sceneTextureCount = static_cast<uint32_t>(std::stoul(value));
+		}
+		else if (key == "pipelines") {
+			options.pipelineVariantCount = static_cast<uint32_t>(std::stoul(value));
+		}
+		else if (key == "frames") {
+			options.frameCount = static_cast<uint32_t>(std::stoul(value));
+		}
+		else if (key == "frames-in-flight") {
+			options.framesInFlight = static_cast<uint32_t>(std::stoul(value));
+		}
+		else if (key == "size") {
+			options.headlessExtent = parseExtent(value);
+		}
+		else if (key == "mesh") {
+			options.meshPath = value;
+		}
+		else if (key == "vertex-format") {
+			options.vertexFormat = parseVertexFormat(value);
+		}
+		else {
+			throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": unknown key " + key);
+		}
+	}
+}
+
+AppOptions parseOptions(int argc, char** argv) {
+	AppOptions options;
+
+#ifdef VULKAN_TUTORIAL_BENCHMARK
+	// The benchmark build is this program with a headless, profiled run and a
+	// JSON report as the defaults.
+	options.headless = true;
+	options.profile = true;
+	options.jsonPath = BENCHMARK_REPORT_PATH;
+#endif
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+
+		if (arg == "--benchmark-uploads") {
+			options.benchmarkUploads = true;
+		}
+		else if (arg == "--benchmark-recording") {
+			options.benchmarkRecording = true;
+		}
+		else if (arg == "--verify-culling") {
+			options.verifyCulling = true;
+		}
+		else if (arg == "--verify-pipelines") {
+			options.verifyPipelines = true;
+		}
+		else if (arg == "--compare-texture-formats") {
+			options.compareTextureFormats = true;
+		}
+		else if (arg == "--benchmark-texture-loading") {
+			options.benchmarkTextureLoading = true;
+		}
+		else if (arg == "--benchmark-vertex-formats") {
+			options.benchmarkVertexFormats = true;
+		}
+		else if (arg == "--headless") {
+			options.headless = true;
+		}
+		else if (arg == "--frames") {
+			if (i + 1 >= argc) {
+				throw std::runtime_error("missing value for " + arg);
+			}
+			options.frameCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--frames-in-flight") {
+			if (i + 1 >= argc) {
+				throw std::runtime_error("missing value for " + arg);
+			}
+			options.framesInFlight = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--output") {
+			if (i + 1 >= argc) {
+				throw std::runtime_error("missing value for " + arg);
+			}
+			options.outputPath = argv[++i];
+		}
+		else if (arg == "--output-format") {
+			if (i + 1 >= argc) {
+				throw std::runtime_error("missing value for " + arg);
+			}
+			options.outputFormat = parseFrameFormat(argv[++i]);
+		}
+		else if (arg == "--size") {
+			if (i + 1 >= argc) {
+				throw std::runtime_error("missing value for " + arg);
+			}
+			options.headlessExtent = parseExtent(argv[++i]);
+		}
+		else if (arg == "--scene") {
+			if (i + 1 >= argc) {
+				throw std::runtime_error("missing value for " + arg);
+			}
+			applySceneFile(options, argv[++i]);
+		}
+		else if (arg == "--draws") {
+			if (i + 1 >= argc) {
+				throw std::runtime_error("missing value for " + arg);
+			}
+			options.drawCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--textures") {
+			if (i + 1 >= argc) {
+				throw std::runtime_error("missing value for " + arg);
+			}
+			options.sceneTextureCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--pipeline-variants") {
+			if (i + 1 >= argc) {
+				throw std::runtime_error("missing value for " + arg);
+			}
+			options.pipelineVariantCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--json") {
+			if (i + 1 >= argc) {
+				throw std::runtime_error("missing value for " + arg);
+			}
+			options.jsonPath = argv[++i];
+		}
+		else if (arg == "--profile") {
+			options.profile = true;
+		}
+		else if (arg == "--trace") {
+			if (i + 1 >= argc) {
+				throw std::runtime_error("missing value for " + arg);
+			}
+			options.tracePath = argv[++i];
+			options.profile = true;
+		}
+		else if (arg == "--stats") {
+			options.stats = true;
+		}
+		else if (arg == "--stats-csv") {
+			if (i + 1 >= argc) {
+				throw std::runtime_error("missing value for " + arg);
+			}
+			options.statsCsvPath = argv[++i];
+		}
+		else if (arg == "--record-threads") {
+			if (i + 1 >= argc) {
+				throw std::runtime_error("missing value for " + arg);
+			}
+			options.recordThreads = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--instances") {
+			if (i + 1 >= argc) {
+				throw std::runtime_error("missing value for " + arg);
+			}
+			options.instanceCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--mesh") {
+			if (i + 1 >= argc) {
+				throw std::runtime_error("missing value for " + arg);
+			}
+			options.meshPath = argv[++i];
+		}
+		else if (arg == "--vertex-format") {
+			if (i + 1 >= argc) {
+				throw std::runtime_error("missing value for " + arg);
+			}
+			options.vertexFormat = parseVertexFormat(argv[++i]);
+		}
+		else {
+			throw std::runtime_error("unknown option: " + arg);
+		}
+	}
+
+	if (options.pipelineVariantCount < 1 || options.pipelineVariantCount > MAX_PIPELINE_VARIANTS) {
+		throw std::runtime_error("pipeline variants must be between 1 and " + std::to_string(MAX_PIPELINE_VARIANTS));
+	}
+	if (options.framesInFlight < 1 || options.framesInFlight > MAX_FRAMES_IN_FLIGHT) {
+		throw std::runtime_error("frames in flight must be between 1 and " + std::to_string(MAX_FRAMES_IN_FLIGHT));
+	}
+	if (!options.jsonPath.empty() && !options.headless) {
+		throw std::runtime_error("a JSON report needs a headless run");
+	}
+
+	return options;
+}
+
 VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger) {
 	auto func = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
 	if (func != nullptr) {
@@ -60,6 +391,7 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT
 struct QueueFamilyIndices {
 	std::optional<uint32_t> graphicsFamily;
 	std::optional<uint32_t> presentFamily;
+	std::optional<uint32_t> transferFamily;
 
 	bool isComplete() {
 		return graphicsFamily.has_value() && presentFamily.has_value();
@@ -72,74 +404,189 @@ struct SwapChainSupportDetails {
 	std::vector<VkPresentModeKHR> presentModes;
 };
 
-struct Vertex {
-	glm::vec2 pos;
-	glm::vec3 color;
+struct InstanceData {
+	glm::mat4 model;
 
-	static VkVertexInputBindingDescription getBindingDescription() {
+	static VkVertexInputBindingDescription getBindingDescription(uint32_t binding) {
 		VkVertexInputBindingDescription bindingDescription{};
-		bindingDescription.binding = 0;
-		bindingDescription.stride = sizeof(Vertex);
-		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		bindingDescription.binding = binding;
+		bindingDescription.stride = sizeof(InstanceData);
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
 
 		return bindingDescription;
 	}
 
-	static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions() {
-		std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
+	static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions(uint32_t binding, uint32_t firstLocation) {
+		std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions{};
 
-		attributeDescriptions[0].binding = 0;
-		attributeDescriptions[0].location = 0;
-		attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
-		attributeDescriptions[0].offset = offsetof(Vertex, pos);
-
-		attributeDescriptions[1].binding = 0;
-		attributeDescriptions[1].location = 1;
-		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[1].offset = offsetof(Vertex, color);
+		for (uint32_t column = 0; column < 4; column++) {
+			attributeDescriptions[column].binding = binding;
+			attributeDescriptions[column].location = firstLocation + column;
+			attributeDescriptions[column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+			attributeDescriptions[column].offset = offsetof(InstanceData, model) + sizeof(glm::vec4) * column;
+		}
 
 		return attributeDescriptions;
 	}
 };
 
+// Full precision vertex that meshes are built and deduplicated in. It is
+// encoded into one of the VertexLayout.h formats when the mesh file is written.
+struct Vertex {
+	glm::vec3 pos;
+	glm::vec3 normal;
+	glm::vec3 color;
+
+	bool operator==(const Vertex& other) const {
+		return pos == other.pos && normal == other.normal && color == other.color;
+	}
+};
+
+namespace std {
+	template<> struct hash<Vertex> {
+		size_t operator()(Vertex const& vertex) const {
+			return ((hash<glm::vec3>()(vertex.pos) ^ (hash<glm::vec3>()(vertex.normal) << 1)) >> 1) ^ (hash<glm::vec3>()(vertex.color) << 1);
+		}
+	};
+}
+
+// Mesh vertices on binding 0 at locations 0-2, instance matrices on binding 1 after them.
+template<typename Layout>
+void setMeshVertexLayout(PipelineStateDesc& pipelineState) {
+	std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = { Layout::getBindingDescription(0), InstanceData::getBindingDescription(1) };
+
+	auto vertexAttributes = Layout::getAttributeDescriptions(0);
+	auto instanceAttributes = InstanceData::getAttributeDescriptions(1, Layout::attributeCount);
+
+	std::array<VkVertexInputAttributeDescription, Layout::attributeCount + 4> attributeDescriptions{};
+	std::copy(vertexAttributes.begin(), vertexAttributes.end(), attributeDescriptions.begin());
+	std::copy(instanceAttributes.begin(), instanceAttributes.end(), attributeDescriptions.begin() + Layout::attributeCount);
+
+	pipelineState.setVertexLayout(bindingDescriptions, attributeDescriptions);
+}
+
 struct UniformBufferObject {
-	alignas(16) glm::mat4 model;
 	alignas(16) glm::mat4 view;
 	alignas(16) glm::mat4 proj;
 };
 
+// One per draw, packed into a per-frame buffer at minUniformBufferOffsetAlignment
+// steps and selected with a dynamic offset.
+struct ObjectUniforms {
+	alignas(16) glm::mat4 model;
+};
+
+// textureIndex is a bindless table handle.
+struct DrawPushConstants {
+	glm::vec4 tint;
+	uint32_t textureIndex;
+};
+
+// One per draw in the culling pass's storage buffer, laid out to match the
+// std430 CullDraw struct in cull.comp.
+struct CullDrawData {
+	glm::mat4 model;
+	uint32_t firstInstance;
+	uint32_t instanceCount;
+	uint32_t padding[2];
+};
+
+struct CullPushConstants {
+	glm::vec4 boundingSphere;
+	uint32_t firstDraw;
+};
+
 const std::vector<Vertex> vertices = {
-	{{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}},
-	{{0.5f, -0.5f},  {0.0f, 1.0f, 0.0f}},
-	{{0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}},
-	{{-0.5f, 0.5f}, {1.0f, 1.0f, 1.0f}}
+	{{-0.5f, -0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.0f, 0.0f}},
+	{{0.5f, -0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f, 0.0f}},
+	{{0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 1.0f}},
+	{{-0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f, 1.0f}}
 };
 
-const std::vector<uint16_t> indices = {
+const std::vector<uint32_t> indices = {
 	0, 1, 2, 2, 3, 0
 };
 
+struct DrawItem {
+	uint32_t indexCount;
+	uint32_t instanceCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	uint32_t firstInstance;
+	uint32_t pipelineVariant;
+	glm::vec4 tint;
+};
+
 class HelloTriangleApplication {
 public:
+	explicit HelloTriangleApplication(const AppOptions& options) : options(options) {}
+
 	void run() {
-		initWindow();
+		auto initStart = std::chrono::high_resolution_clock::now();
+
+		if (!options.headless) {
+			initWindow();
+		}
 		initVulkan();
-		mainLoop();
+
+		initMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - initStart).count();
+		if (options.benchmarkUploads) {
+			benchmarkUploads();
+		}
+		else if (options.benchmarkRecording) {
+			benchmarkRecording();
+		}
+		else if (options.verifyCulling) {
+			verifyCulling();
+		}
+		else if (options.verifyPipelines) {
+			verifyPipelines();
+		}
+		else if (options.compareTextureFormats) {
+			compareTextureFormats();
+		}
+		else if (options.benchmarkTextureLoading) {
+			benchmarkTextureLoading();
+		}
+		else if (options.benchmarkVertexFormats) {
+			benchmarkVertexFormats();
+		}
+		else {
+			mainLoop();
+		}
+		reportProfile();
+		reportFrameStats();
+		if (!options.jsonPath.empty()) {
+			writeBenchmarkReport(options.jsonPath);
+		}
 		cleanup();
 	}
 
 private:
-	GLFWwindow* window;
+	AppOptions options;
+
+	GLFWwindow* window = nullptr;
+
+	AssetPack assetPack;
 
 	VkInstance instance;
 	VkDebugUtilsMessengerEXT debugMessenger;
-	VkSurfaceKHR surface;
+	VkSurfaceKHR surface = VK_NULL_HANDLE;
 
 	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
 	VkDevice device;
+	bool textureCompressionBC = false;
+
+	DeviceMemoryAllocator memoryAllocator;
 
 	VkQueue graphicsQueue;
 	VkQueue presentQueue;
+	VkQueue transferQueue;
+	std::vector<uint32_t> resourceQueueFamilies;
+
+	UploadManager uploadManager;
+	TextureLoader textureLoader;
+	uint64_t pendingUploadValue = 0;
 
 	VkSwapchainKHR swapChain;
 	std::vector<VkImage> swapChainImages;
@@ -148,36 +595,109 @@ private:
 	std::vector<VkImageView> swapChainImageViews;
 	std::vector<VkFramebuffer> swapChainFramebuffers;
 
+	// Objects released while frames are in flight, destroyed as the frame
+	// timeline passes them. submittedFrameValue is the value of the last frame
+	// submitted, which is the tag for anything no later frame will use.
+	DeletionQueue deletionQueue;
+	uint64_t submittedFrameValue = 0;
+
+	// Headless mode renders into these instead of swap chain images, one per
+	// frame in flight, and streams every frame out through frameReadback.
+	std::vector<Allocation> offscreenImagesAllocation;
+	FrameReadback frameReadback;
+
 	VkRenderPass renderPass;
 	VkDescriptorSetLayout descriptorSetLayout;
 	VkPipelineLayout pipelineLayout;
+	VkShaderModule vertShaderModule;
+	VkShaderModule fragShaderModule;
 	VkPipeline graphicsPipeline;
 
+	PipelineCache pipelineCache;
+	PipelineRegistry pipelineRegistry;
+	std::vector<PipelineStateDesc> pipelineVariants;
+	std::vector<VkPipeline> resolvedPipelines;
+	float pipelineCreationMs = 0.0f;
+
+	VkDescriptorSetLayout cullDescriptorSetLayout;
+	VkPipelineLayout cullPipelineLayout;
+	VkPipeline cullPipeline;
+
 	VkCommandPool commandPool;
 
+	ThreadPool threadPool;
+	ParallelRecorder parallelRecorder;
+	Profiler profiler;
+	FrameStats frameStats;
+	double lastStatsReport = 0.0;
+	std::vector<DrawItem> drawItems;
+	std::vector<VkCommandBuffer> secondaryCommandBuffers;
+
 	VkImage textureImage;
-	VkDeviceMemory textureImageMemory;
+	Allocation textureImageAllocation;
 	VkImageView textureImageView;
 	VkSampler textureSampler;
+	uint32_t textureHandle;
+	VkFormat textureFormat;
+	uint32_t textureWidth;
+	uint32_t textureHeight;
+	uint32_t textureMipLevels;
+	uint32_t textureResidentMip;
+	std::vector<std::vector<uint8_t>> textureMipChain;
+
+	// Synthetic textures from benchmark scenes, spread across the draws so that
+	// a scene's texture count is also how many materials it samples.
+	std::vector<VkImage> sceneTextureImages;
+	std::vector<Allocation> sceneTextureImagesAllocation;
+	std::vector<VkImageView> sceneTextureImageViews;
+	std::vector<uint32_t> sceneTextureHandles;
+
+	BindlessTable bindlessTable;
+
+	float initMs = 0.0f;
+	float headlessRenderMs = 0.0f;
+
+	std::vector<char> meshStorage;
+	MeshView mesh;
 
 	VkBuffer vertexBuffer;
-	VkDeviceMemory vertexBufferMemory;
+	Allocation vertexBufferAllocation;
 	VkBuffer indexBuffer;
-	VkDeviceMemory indexBufferMemory;
+	Allocation indexBufferAllocation;
+	VkBuffer instanceBuffer;
+	Allocation instanceBufferAllocation;
+	// Every draw's command with its instance count at zero. Culling copies it over
+	// the frame's commands and counts the surviving instances back in.
+	VkBuffer indirectBuffer;
+	Allocation indirectBufferAllocation;
+
+	glm::vec4 meshBoundingSphere;
+	uint32_t maxDrawInstanceCount = 0;
+	uint32_t maxCullDispatchDraws = 0;
+	std::vector<VkBuffer> visibleInstanceBuffers;
+	std::vector<Allocation> visibleInstanceBuffersAllocation;
+	std::vector<VkBuffer> culledIndirectBuffers;
+	std::vector<Allocation> culledIndirectBuffersAllocation;
+	std::vector<VkBuffer> cullDrawBuffers;
+	std::vector<Allocation> cullDrawBuffersAllocation;
 
 	std::vector<VkBuffer> uniformBuffers;
-	std::vector<VkDeviceMemory> uniformBuffersMemory;
+	std::vector<Allocation> uniformBuffersAllocation;
 	std::vector<void*> uniformBuffersMapped;
 
-	VkDescriptorPool descriptorPool;
-	std::vector<VkDescriptorSet> descriptorSets;
+	std::vector<VkBuffer> objectUniformBuffers;
+	std::vector<Allocation> objectUniformBuffersAllocation;
+	VkDeviceSize objectUniformStride = 0;
+
+	// Per frame slot, reset wholesale once the slot's previous frame completes.
+	std::vector<DescriptorAllocator> frameDescriptorAllocators;
+	std::vector<DescriptorSetCache> frameDescriptorCaches;
 
 	std::vector<VkCommandBuffer> commandBuffers;
 
-	std::vector<VkSemaphore> imageAvailableSemaphores;
-	std::vector<VkSemaphore> renderFinishedSemaphores;
-	std::vector<VkFence> inFlightFences;
+	FrameScheduler frameScheduler;
 	uint32_t currentFrame = 0;
+	uint64_t frameNumber = 0;
 
 	bool framebufferResized = false;
 
@@ -197,37 +717,104 @@ private:
 	}
 
 	void initVulkan() {
+		assetPack.open(ASSET_PACK_PATH);
+
 		createInstance();
 		setupDebugMessenger();
-		createSurface();
+		if (!options.headless) {
+			createSurface();
+		}
 		pickPhysicalDevice();
 		createLogicalDevice();
-		createSwapChain();
+		createMemoryAllocator();
+		if (options.headless) {
+			createOffscreenTargets();
+		}
+		else {
+			createSwapChain();
+		}
 		createImageViews();
 		createRenderPass();
 		createDescriptorSetLayout();
+		createBindlessTable();
+		createPipelineCache();
+		loadMesh();
 		createGraphicsPipeline();
+		createCullPipeline();
 		createFramebuffers();
 		createCommandPool();
+		createParallelRecorder();
+		createProfiler();
+		createFrameStats();
+		createUploadManager();
 		createTextureImage();
 		createTextureImageView();
 		createTextureSampler();
+		textureHandle = bindlessTable.addTexture(textureImageView, textureSampler);
+		createSceneTextures();
 		createVertexBuffer();
 		createIndexBuffer();
+		createInstanceBuffer();
+		createDrawList();
+		createCullBuffers();
+		submitUploads();
 		createUniformBuffers();
-		createDescriptorPool();
-		createDescriptorSets();
+		createDescriptorAllocators();
 		createCommandBuffers();
 		createSyncObjects();
+
+		printMemoryStats();
+		printPipelineStats();
 	}
 
 	void mainLoop() {
-		while (!glfwWindowShouldClose(window)) {
+		if (options.headless) {
+			headlessLoop();
+			return;
+		}
+
+		while (!glfwWindowShouldClose(window) && (options.frameCount == 0 || frameNumber < options.frameCount)) {
 			glfwPollEvents();
 			drawFrame();
+			updateFrameStatsOverlay();
+		}
+
+		vkDeviceWaitIdle(device);
+	}
+
+	// Renders a fixed number of frames as fast as the device allows while the
+	// readback writer streams them out, then reports how fast frames were
+	// rendered and how fast they made it all the way to the output.
+	void headlessLoop() {
+		uint32_t frameCount = options.frameCount > 0 ? options.frameCount : HEADLESS_DEFAULT_FRAME_COUNT;
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		while (frameNumber < frameCount) {
+			drawFrame();
+			updateFrameStatsOverlay();
 		}
 
 		vkDeviceWaitIdle(device);
+
+		float renderMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+		headlessRenderMs = renderMs;
+
+		frameReadback.collect(frameNumber);
+		frameReadback.flush();
+
+		double readbackSeconds = frameReadback.getElapsedSeconds();
+		FrameReadbackStats stats = frameReadback.getStats();
+
+		std::cout << "headless: " << frameCount << " frames at " << swapChainExtent.width << "x" << swapChainExtent.height << " in " << renderMs << " ms ("
+			<< frameCount * 1000.0f / renderMs << " fps)" << std::endl;
+		std::cout << "readback: " << stats.written << " frames in " << readbackSeconds * 1000.0 << " ms (" << stats.written / readbackSeconds << " fps sustained), "
+			<< stats.dropped << " dropped, " << stats.written * frameReadback.getFrameSize() / (1024.0 * 1024.0) / readbackSeconds << " MiB/s read back, "
+			<< (frameReadback.isCached() ? "cached" : "uncached") << " memory" << std::endl;
+		if (!options.outputPath.empty()) {
+			std::cout << "wrote " << stats.bytesWritten / (1024.0 * 1024.0) << " MiB to " << options.outputPath << " ("
+				<< (stats.written > 0 ? stats.writeSeconds * 1000.0 / stats.written : 0.0) << " ms per frame on the writer)" << std::endl;
+		}
 	}
 
 	void cleanupSwapChain() {
@@ -239,59 +826,123 @@ private:
 			vkDestroyImageView(device, imageView, nullptr);
 		}
 
-		vkDestroySwapchainKHR(device, swapChain, nullptr);
+		if (options.headless) {
+			for (size_t i = 0; i < swapChainImages.size(); i++) {
+				vkDestroyImage(device, swapChainImages[i], nullptr);
+				memoryAllocator.free(offscreenImagesAllocation[i]);
+			}
+
+			frameReadback.cleanup();
+		}
+		else {
+			vkDestroySwapchainKHR(device, swapChain, nullptr);
+		}
 	}
 
 	void cleanup() {
+		deletionQueue.flushAll();
 		cleanupSwapChain();
 
-		vkDestroyPipeline(device, graphicsPipeline, nullptr);
+		vkDestroyPipeline(device, cullPipeline, nullptr);
+		vkDestroyPipelineLayout(device, cullPipelineLayout, nullptr);
+
+		pipelineRegistry.cleanup();
+		vkDestroyShaderModule(device, fragShaderModule, nullptr);
+		vkDestroyShaderModule(device, vertShaderModule, nullptr);
 		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+		pipelineCache.cleanup();
 		vkDestroyRenderPass(device, renderPass, nullptr);
 
-		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+		for (size_t i = 0; i < options.framesInFlight; i++) {
 			vkDestroyBuffer(device, uniformBuffers[i], nullptr);
-			vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
+			memoryAllocator.free(uniformBuffersAllocation[i]);
+
+			vkDestroyBuffer(device, objectUniformBuffers[i], nullptr);
+			memoryAllocator.free(objectUniformBuffersAllocation[i]);
 		}
 
-		vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+		for (auto& allocator : frameDescriptorAllocators) {
+			allocator.cleanup();
+		}
+		bindlessTable.cleanup();
 
 		vkDestroySampler(device, textureSampler, nullptr);
 		vkDestroyImageView(device, textureImageView, nullptr);
 
 		vkDestroyImage(device, textureImage, nullptr);
-		vkFreeMemory(device, textureImageMemory, nullptr);
+		memoryAllocator.free(textureImageAllocation);
+
+		for (size_t i = 0; i < sceneTextureImages.size(); i++) {
+			vkDestroyImageView(device, sceneTextureImageViews[i], nullptr);
+			vkDestroyImage(device, sceneTextureImages[i], nullptr);
+			memoryAllocator.free(sceneTextureImagesAllocation[i]);
+		}
 
+		vkDestroyDescriptorSetLayout(device, cullDescriptorSetLayout, nullptr);
 		vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
 
+		for (size_t i = 0; i < options.framesInFlight; i++) {
+			vkDestroyBuffer(device, culledIndirectBuffers[i], nullptr);
+			memoryAllocator.free(culledIndirectBuffersAllocation[i]);
+
+			vkDestroyBuffer(device, visibleInstanceBuffers[i], nullptr);
+			memoryAllocator.free(visibleInstanceBuffersAllocation[i]);
+
+			vkDestroyBuffer(device, cullDrawBuffers[i], nullptr);
+			memoryAllocator.free(cullDrawBuffersAllocation[i]);
+		}
+
+		vkDestroyBuffer(device, indirectBuffer, nullptr);
+		memoryAllocator.free(indirectBufferAllocation);
+
+		vkDestroyBuffer(device, instanceBuffer, nullptr);
+		memoryAllocator.free(instanceBufferAllocation);
+
 		vkDestroyBuffer(device, indexBuffer, nullptr);
-		vkFreeMemory(device, indexBufferMemory, nullptr);
+		memoryAllocator.free(indexBufferAllocation);
 
 		vkDestroyBuffer(device, vertexBuffer, nullptr);
-		vkFreeMemory(device, vertexBufferMemory, nullptr);
+		memoryAllocator.free(vertexBufferAllocation);
 
-		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-			vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
-			vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
-			vkDestroyFence(device, inFlightFences[i], nullptr);
-		}
+		frameScheduler.cleanup();
+
+		parallelRecorder.cleanup();
+		threadPool.cleanup();
+
+		profiler.cleanup();
+		frameStats.cleanup();
 
 		vkDestroyCommandPool(device, commandPool, nullptr);
 
+		uploadManager.cleanup();
+		memoryAllocator.cleanup();
+
 		vkDestroyDevice(device, nullptr);
 
 		if (enableValidationLayers) {
 			DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
 		}
 
-		vkDestroySurfaceKHR(instance, surface, nullptr);
+		if (surface != VK_NULL_HANDLE) {
+			vkDestroySurfaceKHR(instance, surface, nullptr);
+		}
 		vkDestroyInstance(instance, nullptr);
 
-		glfwDestroyWindow(window);
+		assetPack.close();
+
+		if (window != nullptr) {
+			glfwDestroyWindow(window);
 
-		glfwTerminate();
+			glfwTerminate();
+		}
 	}
 
+	// Builds the new swap chain from the old one without draining the GPU. Frames
+	// already submitted keep rendering into the old framebuffers, so those go on
+	// the deletion queue rather than being destroyed. Presentation has no
+	// completion signal of its own, so the old swap chain is only released once
+	// the frames in flight after it have completed as well, by which point its
+	// queued presents are done.
 	void recreateSwapChain() {
 		int width = 0, height = 0;
 		glfwGetFramebufferSize(window, &width, &height);
@@ -300,11 +951,16 @@ private:
 			glfwWaitEvents();
 		}
 
-		vkDeviceWaitIdle(device);
-
-		cleanupSwapChain();
+		uint64_t retireValue = submittedFrameValue + frameScheduler.getFramesInFlight();
+		for (auto framebuffer : swapChainFramebuffers) {
+			deletionQueue.destroyFramebuffer(retireValue, framebuffer);
+		}
+		for (auto imageView : swapChainImageViews) {
+			deletionQueue.destroyImageView(retireValue, imageView);
+		}
+		deletionQueue.destroySwapchain(retireValue, swapChain);
 
-		createSwapChain();
+		createSwapChain(swapChain);
 		createImageViews();
 		createFramebuffers();
 	}
@@ -320,7 +976,7 @@ private:
 		appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 		appInfo.pEngineName = "No Engine";
 		appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-		appInfo.apiVersion = VK_API_VERSION_1_0;
+		appInfo.apiVersion = VK_API_VERSION_1_2;
 
 		VkInstanceCreateInfo createInfo{};
 		createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -402,6 +1058,9 @@ private:
 
 		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 		std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+		if (indices.transferFamily.has_value()) {
+			uniqueQueueFamilies.insert(indices.transferFamily.value());
+		}
 
 		float queuePriority = 1.0f;
 		for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -413,19 +1072,37 @@ private:
 			queueCreateInfos.push_back(queueCreateInfo);
 		}
 
+		VkPhysicalDeviceFeatures supportedFeatures;
+		vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+		textureCompressionBC = supportedFeatures.textureCompressionBC == VK_TRUE;
+
 		VkPhysicalDeviceFeatures deviceFeatures{};
 		deviceFeatures.samplerAnisotropy = VK_TRUE;
+		deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+		deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+
+		VkPhysicalDeviceVulkan12Features vulkan12Features{};
+		vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		vulkan12Features.timelineSemaphore = VK_TRUE;
+		vulkan12Features.descriptorIndexing = VK_TRUE;
+		vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+		vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+		vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+		vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+		vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
 
 		VkDeviceCreateInfo createInfo{};
 		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		createInfo.pNext = &vulkan12Features;
 
 		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 		createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
 		createInfo.pEnabledFeatures = &deviceFeatures;
 
-		createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-		createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+		std::vector<const char*> extensions = getDeviceExtensions();
+		createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+		createInfo.ppEnabledExtensionNames = extensions.data();
 
 		if (enableValidationLayers) {
 			createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -441,9 +1118,23 @@ private:
 
 		vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
 		vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+
+		resourceQueueFamilies = { indices.graphicsFamily.value() };
+		if (indices.transferFamily.has_value()) {
+			vkGetDeviceQueue(device, indices.transferFamily.value(), 0, &transferQueue);
+			resourceQueueFamilies.push_back(indices.transferFamily.value());
+		}
+		else {
+			transferQueue = graphicsQueue;
+		}
+	}
+
+	void createMemoryAllocator() {
+		memoryAllocator.init(physicalDevice, device);
+		deletionQueue.init(device, &memoryAllocator);
 	}
 
-	void createSwapChain() {
+	void createSwapChain(VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE) {
 		SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
 
 		VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
@@ -482,6 +1173,7 @@ private:
 		createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 		createInfo.presentMode = presentMode;
 		createInfo.clipped = VK_TRUE;
+		createInfo.oldSwapchain = oldSwapChain;
 
 		if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create swap chain!");
@@ -495,11 +1187,27 @@ private:
 		swapChainExtent = extent;
 	}
 
+	void createOffscreenTargets() {
+		swapChainImageFormat = HEADLESS_COLOR_FORMAT;
+		swapChainExtent = options.headlessExtent;
+
+		swapChainImages.resize(options.framesInFlight);
+		offscreenImagesAllocation.resize(options.framesInFlight);
+
+		for (size_t i = 0; i < options.framesInFlight; i++) {
+			createImage(swapChainExtent.width, swapChainExtent.height, 1, swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapChainImages[i], offscreenImagesAllocation[i]);
+		}
+
+		FrameFormat format = options.outputFormat.value_or(guessFrameFormat(options.outputPath));
+		frameReadback.init(physicalDevice, device, &memoryAllocator, swapChainExtent, options.framesInFlight + READBACK_QUEUE_DEPTH, options.outputPath, format,
+			static_cast<uint32_t>(std::lround(1.0f / HEADLESS_FRAME_TIME)));
+	}
+
 	void createImageViews() {
 		swapChainImageViews.resize(swapChainImages.size());
 
 		for (size_t i = 0; i < swapChainImages.size(); i++) {
-			swapChainImageViews[i] = createImageView(swapChainImages[i], swapChainImageFormat);
+			swapChainImageViews[i] = createImageView(swapChainImages[i], swapChainImageFormat, 0, 1);
 		}
 	}
 
@@ -512,7 +1220,7 @@ private:
 		colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		colorAttachment.finalLayout = options.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 		VkAttachmentReference colorAttachmentRef{};
 		colorAttachmentRef.attachment = 0;
@@ -523,13 +1231,21 @@ private:
 		subpass.colorAttachmentCount = 1;
 		subpass.pColorAttachments = &colorAttachmentRef;
 
-		VkSubpassDependency dependency{};
-		dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-		dependency.dstSubpass = 0;
-		dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependency.srcAccessMask = 0;
-		dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		std::array<VkSubpassDependency, 2> dependencies{};
+		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[0].dstSubpass = 0;
+		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[0].srcAccessMask = 0;
+		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+		// Headless frames are copied out right after the pass.
+		dependencies[1].srcSubpass = 0;
+		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
 
 		VkRenderPassCreateInfo renderPassInfo{};
 		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -537,8 +1253,8 @@ private:
 		renderPassInfo.pAttachments = &colorAttachment;
 		renderPassInfo.subpassCount = 1;
 		renderPassInfo.pSubpasses = &subpass;
-		renderPassInfo.dependencyCount = 1;
-		renderPassInfo.pDependencies = &dependency;
+		renderPassInfo.dependencyCount = options.headless ? 2 : 1;
+		renderPassInfo.pDependencies = dependencies.data();
 
 		if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create render pass!");
@@ -553,149 +1269,200 @@ private:
 		uboLayoutBinding.pImmutableSamplers = nullptr;
 		uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
+		VkDescriptorSetLayoutBinding objectLayoutBinding{};
+		objectLayoutBinding.binding = 1;
+		objectLayoutBinding.descriptorCount = 1;
+		objectLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		objectLayoutBinding.pImmutableSamplers = nullptr;
+		objectLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+		std::array<VkDescriptorSetLayoutBinding, 2> bindings = { uboLayoutBinding, objectLayoutBinding };
+
 		VkDescriptorSetLayoutCreateInfo layoutInfo{};
 		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-		layoutInfo.bindingCount = 1;
-		layoutInfo.pBindings = &uboLayoutBinding;
+		layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+		layoutInfo.pBindings = bindings.data();
 
 		if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create descriptor set layout!");
 		}
 	}
 
+	void createBindlessTable() {
+		bindlessTable.init(physicalDevice, device);
+	}
+
+	void createPipelineCache() {
+		pipelineCache.init(physicalDevice, device, PIPELINE_CACHE_FILE);
+		pipelineRegistry.init(device, pipelineCache.get());
+	}
+
 	void createGraphicsPipeline() {
-		auto vertShaderCode = readFile("shaders/vert.spv");
-		auto fragShaderCode = readFile("shaders/frag.spv");
-
-		VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-		VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
-
-		VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-		vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-		vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-		vertShaderStageInfo.module = vertShaderModule;
-		vertShaderStageInfo.pName = "main";
-
-		VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-		fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-		fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		fragShaderStageInfo.module = fragShaderModule;
-		fragShaderStageInfo.pName = "main";
-
-		VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
-
-		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-
-		auto bindingDescription = Vertex::getBindingDescription();
-		auto attributeDescriptions = Vertex::getAttributeDescriptions();
-
-		vertexInputInfo.vertexBindingDescriptionCount = 1;
-		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-		vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-		vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
-
-		VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-		inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-		inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-		VkPipelineViewportStateCreateInfo viewportState{};
-		viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-		viewportState.viewportCount = 1;
-		viewportState.scissorCount = 1;
-
-		VkPipelineRasterizationStateCreateInfo rasterizer{};
-		rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-		rasterizer.depthClampEnable = VK_FALSE;
-		rasterizer.rasterizerDiscardEnable = VK_FALSE;
-		rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-		rasterizer.lineWidth = 1.0f;
-		rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-		rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-		rasterizer.depthBiasEnable = VK_FALSE;
-
-		VkPipelineMultisampleStateCreateInfo multisampling{};
-		multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-		multisampling.sampleShadingEnable = VK_FALSE;
-		multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-
-		VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-		colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-		colorBlendAttachment.blendEnable = VK_FALSE;
-
-		VkPipelineColorBlendStateCreateInfo colorBlending{};
-		colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-		colorBlending.logicOpEnable = VK_FALSE;
-		colorBlending.logicOp = VK_LOGIC_OP_COPY;
-		colorBlending.attachmentCount = 1;
-		colorBlending.pAttachments = &colorBlendAttachment;
-		colorBlending.blendConstants[0] = 0.0f;
-		colorBlending.blendConstants[1] = 0.0f;
-		colorBlending.blendConstants[2] = 0.0f;
-		colorBlending.blendConstants[3] = 0.0f;
-
-		std::vector<VkDynamicState> dynamicStates = {
-			VK_DYNAMIC_STATE_VIEWPORT,
-			VK_DYNAMIC_STATE_SCISSOR
-		};
-		VkPipelineDynamicStateCreateInfo dynamicState{};
-		dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-		dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
-		dynamicState.pDynamicStates = dynamicStates.data();
+		std::vector<char> vertShaderStorage, fragShaderStorage;
+		VertexFormat vertexFormat = static_cast<VertexFormat>(mesh.vertexFormat);
+		AssetView vertShaderCode = loadAsset(vertexFormat == VertexFormat::Octahedral ? "shaders/vert_octahedral.spv" : "shaders/vert.spv", vertShaderStorage);
+		AssetView fragShaderCode = loadAsset("shaders/frag.spv", fragShaderStorage);
+
+		vertShaderModule = createShaderModule(vertShaderCode);
+		fragShaderModule = createShaderModule(fragShaderCode);
+
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(DrawPushConstants);
+
+		std::array<VkDescriptorSetLayout, 2> setLayouts = { descriptorSetLayout, bindlessTable.getLayout() };
 
 		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipelineLayoutInfo.setLayoutCount = 1;
-		pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+		pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+		pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
 		if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create pipeline layout!");
 		}
 
-		VkGraphicsPipelineCreateInfo pipelineInfo{};
-		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-		pipelineInfo.stageCount = 2;
-		pipelineInfo.pStages = shaderStages;
-		pipelineInfo.pVertexInputState = &vertexInputInfo;
-		pipelineInfo.pInputAssemblyState = &inputAssembly;
-		pipelineInfo.pViewportState = &viewportState;
-		pipelineInfo.pRasterizationState = &rasterizer;
-		pipelineInfo.pMultisampleState = &multisampling;
-		pipelineInfo.pColorBlendState = &colorBlending;
-		pipelineInfo.pDynamicState = &dynamicState;
-		pipelineInfo.layout = pipelineLayout;
-		pipelineInfo.renderPass = renderPass;
-		pipelineInfo.subpass = 0;
-		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-
-		if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create graphics pipeline!");
+		PipelineStateDesc pipelineState{};
+		pipelineState.vertexShader = vertShaderModule;
+		pipelineState.fragmentShader = fragShaderModule;
+		pipelineState.layout = pipelineLayout;
+		pipelineState.renderPass = renderPass;
+		pipelineState.subpass = 0;
+		visitVertexFormat(vertexFormat, [&](auto vertex) { setMeshVertexLayout<decltype(vertex)>(pipelineState); });
+		pipelineState.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		pipelineState.cullMode = VK_CULL_MODE_BACK_BIT;
+		pipelineState.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+		pipelineState.blendEnable = VK_FALSE;
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		graphicsPipeline = pipelineRegistry.getOrCreate(pipelineState);
+		pipelineVariants.push_back(pipelineState);
+
+		// Benchmark runs build the extra variants up front so their frames measure
+		// drawing with them, not compiling them. Otherwise they compile in the
+		// background and their draws use the base pipeline until they are ready.
+		bool prebuildVariants = !options.jsonPath.empty() || options.benchmarkRecording;
+		for (uint32_t i = 1; i < options.pipelineVariantCount; i++) {
+			PipelineStateDesc variant = makePipelineVariant(pipelineState, i);
+			if (prebuildVariants) {
+				pipelineRegistry.getOrCreate(variant);
+			}
+			else {
+				pipelineRegistry.request(variant, graphicsPipeline);
+			}
+			pipelineVariants.push_back(variant);
 		}
 
-		vkDestroyShaderModule(device, fragShaderModule, nullptr);
-		vkDestroyShaderModule(device, vertShaderModule, nullptr);
+		pipelineCreationMs += std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
 	}
 
-	void createFramebuffers() {
-		swapChainFramebuffers.resize(swapChainImageViews.size());
+	// Variant 0 is base itself; the rest step through fixed-function state that
+	// needs no shader or layout changes. MAX_PIPELINE_VARIANTS is the product of
+	// the option counts.
+	static PipelineStateDesc makePipelineVariant(const PipelineStateDesc& base, uint32_t index) {
+		const VkCullModeFlags cullModes[] = { VK_CULL_MODE_BACK_BIT, VK_CULL_MODE_NONE, VK_CULL_MODE_FRONT_BIT };
+		const VkFrontFace frontFaces[] = { VK_FRONT_FACE_COUNTER_CLOCKWISE, VK_FRONT_FACE_CLOCKWISE };
+		const VkBool32 blendModes[] = { VK_FALSE, VK_TRUE };
+		const VkPrimitiveTopology topologies[] = { VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_PRIMITIVE_TOPOLOGY_LINE_LIST };
+
+		PipelineStateDesc variant = base;
+		variant.cullMode = cullModes[index % 3];
+		index /= 3;
+		variant.frontFace = frontFaces[index % 2];
+		index /= 2;
+		variant.blendEnable = blendModes[index % 2];
+		index /= 2;
+		variant.topology = topologies[index % 2];
+		return variant;
+	}
 
-		for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-			VkImageView attachments[] = {
-				swapChainImageViews[i]
-			};
+	static VkDescriptorType getCullDescriptorType(uint32_t binding) {
+		return binding == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	}
 
-			VkFramebufferCreateInfo framebufferInfo{};
-			framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-			framebufferInfo.renderPass = renderPass;
-			framebufferInfo.attachmentCount = 1;
-			framebufferInfo.pAttachments = attachments;
-			framebufferInfo.width = swapChainExtent.width;
-			framebufferInfo.height = swapChainExtent.height;
-			framebufferInfo.layers = 1;
+	void createCullPipeline() {
+		std::array<VkDescriptorSetLayoutBinding, 5> bindings{};
+		for (uint32_t i = 0; i < bindings.size(); i++) {
+			bindings[i].binding = i;
+			bindings[i].descriptorCount = 1;
+			bindings[i].descriptorType = getCullDescriptorType(i);
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
 
-			if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS) {
-				throw std::runtime_error("failed to create framebuffer!");
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+		layoutInfo.pBindings = bindings.data();
+
+		if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &cullDescriptorSetLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create culling descriptor set layout!");
+		}
+
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(CullPushConstants);
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &cullDescriptorSetLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+		if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &cullPipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create culling pipeline layout!");
+		}
+
+		std::vector<char> compShaderStorage;
+		AssetView compShaderCode = loadAsset("shaders/cull.spv", compShaderStorage);
+		VkShaderModule compShaderModule = createShaderModule(compShaderCode);
+
+		VkComputePipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = compShaderModule;
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = cullPipelineLayout;
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		if (vkCreateComputePipelines(device, pipelineCache.get(), 1, &pipelineInfo, nullptr, &cullPipeline) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create culling pipeline!");
+		}
+
+		pipelineCreationMs += std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+		vkDestroyShaderModule(device, compShaderModule, nullptr);
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		maxCullDispatchDraws = properties.limits.maxComputeWorkGroupCount[1];
+	}
+
+	void createFramebuffers() {
+		swapChainFramebuffers.resize(swapChainImageViews.size());
+
+		for (size_t i = 0; i < swapChainImageViews.size(); i++) {
+			VkImageView attachments[] = {
+				swapChainImageViews[i]
+			};
+
+			VkFramebufferCreateInfo framebufferInfo{};
+			framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			framebufferInfo.renderPass = renderPass;
+			framebufferInfo.attachmentCount = 1;
+			framebufferInfo.pAttachments = attachments;
+			framebufferInfo.width = swapChainExtent.width;
+			framebufferInfo.height = swapChainExtent.height;
+			framebufferInfo.layers = 1;
+
+			if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create framebuffer!");
 			}
 		}
 	}
@@ -713,38 +1480,297 @@ private:
 		}
 	}
 
+	void createParallelRecorder() {
+		QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+
+		uint32_t threadCount = options.recordThreads > 0 ? options.recordThreads : std::max(std::thread::hardware_concurrency(), 1u);
+		threadPool.init(threadCount);
+		parallelRecorder.init(device, &threadPool, queueFamilyIndices.graphicsFamily.value(), options.framesInFlight);
+	}
+
+	void createProfiler() {
+		QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+
+		profiler.init(physicalDevice, device, queueFamilyIndices.graphicsFamily.value(), options.framesInFlight, options.profile);
+	}
+
+	void reportProfile() {
+		if (!profiler.isEnabled()) {
+			return;
+		}
+
+		vkDeviceWaitIdle(device);
+		profiler.finish();
+
+		std::cout << "profile:" << std::endl;
+		profiler.printStats();
+
+		if (!options.tracePath.empty()) {
+			profiler.writeTrace(options.tracePath);
+		}
+	}
+
+	void createFrameStats() {
+		frameStats.init(profiler.hasGpuTimestamps(), options.statsCsvPath);
+	}
+
+	// With --stats, keeps a rolling summary in the window title, or on the
+	// console when headless.
+	void updateFrameStatsOverlay() {
+		if (!options.stats || frameStats.getTime() - lastStatsReport < FRAME_STATS_REPORT_INTERVAL_MS) {
+			return;
+		}
+		lastStatsReport = frameStats.getTime();
+
+		if (options.headless) {
+			std::cout << "stats: " << frameStats.getSummary() << std::endl;
+		}
+		else {
+			glfwSetWindowTitle(window, ("Vulkan - " + frameStats.getSummary()).c_str());
+		}
+	}
+
+	void reportFrameStats() {
+		if (options.stats) {
+			frameStats.printReport();
+		}
+	}
+
+	// Machine-readable summary of a headless run, meant to be compared against
+	// the report of a baseline build. Stage times need profiling, which the
+	// benchmark build turns on by default.
+	void writeBenchmarkReport(const std::string& path) {
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+		uint64_t instanceCount = 0;
+		for (const auto& draw : drawItems) {
+			instanceCount += draw.instanceCount;
+		}
+
+		double fps = headlessRenderMs > 0.0f ? frameNumber * 1000.0 / headlessRenderMs : 0.0;
+		AllocatorStats memory = memoryAllocator.getStats();
+
+		std::ofstream file(path, std::ios::trunc);
+		if (!file.is_open()) {
+			throw std::runtime_error("failed to open " + path + "!");
+		}
+
+		auto writeStages = [&file](const std::map<std::string, ProfileScopeStats>& stages) {
+			bool first = true;
+			for (const auto& stage : stages) {
+				file << (first ? "" : ",") << "\n    \"" << stage.first << "\": { \"avgMs\": " << stage.second.totalUs / stage.second.count / 1000.0
+					<< ", \"maxMs\": " << stage.second.maxUs / 1000.0 << ", \"count\": " << stage.second.count << " }";
+				first = false;
+			}
+			file << "\n  }";
+		};
+
+		file << std::fixed << std::setprecision(4);
+		file << "{\n";
+		file << "  \"scene\": { \"name\": \"" << options.sceneName << "\", \"objects\": " << instanceCount << ", \"draws\": " << drawItems.size()
+			<< ", \"textures\": " << sceneTextureImages.size() << ", \"pipelines\": " << pipelineVariants.size() << ", \"indicesPerObject\": " << mesh.indexCount
+			<< ", \"frames\": " << frameNumber << ", \"framesInFlight\": " << options.framesInFlight << ", \"width\": " << swapChainExtent.width << ", \"height\": " << swapChainExtent.height << " },\n";
+		file << "  \"device\": { \"name\": \"" << properties.deviceName << "\", \"apiVersion\": \"" << VK_API_VERSION_MAJOR(properties.apiVersion) << "."
+			<< VK_API_VERSION_MINOR(properties.apiVersion) << "." << VK_API_VERSION_PATCH(properties.apiVersion) << "\", \"driverVersion\": " << properties.driverVersion << " },\n";
+		file << "  \"init\": { \"totalMs\": " << initMs << ", \"pipelineCreationMs\": " << pipelineCreationMs
+			<< ", \"pipelineCacheWarm\": " << (pipelineCache.isWarm() ? "true" : "false") << " },\n";
+
+		const char* metricKeys[] = { "interval", "cpu", "slotWait", "acquire", "gpu", "latency" };
+		static_assert(sizeof(metricKeys) / sizeof(metricKeys[0]) == FRAME_METRIC_COUNT, "one key per frame metric");
+
+		file << "  \"frame\": { \"totalMs\": " << headlessRenderMs << ", \"fps\": " << fps;
+		for (uint32_t i = 0; i < FRAME_METRIC_COUNT; i++) {
+			const RollingPercentiles& values = frameStats.getMetric(static_cast<FrameMetric>(i));
+			if (values.size() == 0) {
+				continue;
+			}
+			file << ",\n    \"" << metricKeys[i] << "\": { \"p50\": " << values.percentile(0.5) << ", \"p95\": " << values.percentile(0.95)
+				<< ", \"p99\": " << values.percentile(0.99) << ", \"max\": " << values.max() << " }";
+		}
+		file << "\n  },\n";
+
+		file << "  \"cpuStages\": {";
+		writeStages(profiler.getCpuStats());
+		file << ",\n  \"gpuStages\": {";
+		writeStages(profiler.getGpuStats());
+		file << ",\n";
+
+		file << "  \"memory\": { \"allocations\": " << memory.allocationCount << ", \"blocks\": " << memory.blockCount << ", \"reservedBytes\": " << memory.bytesReserved
+			<< ", \"usedBytes\": " << memory.bytesUsed << ", \"fragmentedBytes\": " << memory.bytesFragmented << " },\n";
+		file << "  \"throughput\": { \"drawsPerSecond\": " << drawItems.size() * fps << ", \"objectsPerSecond\": " << instanceCount * fps
+			<< ", \"trianglesPerSecond\": " << instanceCount * (mesh.indexCount / 3) * fps << " }\n";
+		file << "}\n";
+
+		if (!file) {
+			throw std::runtime_error("failed to write " + path + "!");
+		}
+
+		std::cout << "wrote benchmark report to " << path << std::endl;
+	}
+
+	void createUploadManager() {
+		QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+		bool dedicatedTransfer = queueFamilyIndices.transferFamily.has_value();
+		uint32_t uploadFamily = dedicatedTransfer ? queueFamilyIndices.transferFamily.value() : queueFamilyIndices.graphicsFamily.value();
+
+		uploadManager.init(device, &memoryAllocator, uploadFamily, transferQueue, !dedicatedTransfer);
+		textureLoader.init(&threadPool, &uploadManager);
+	}
+
+	void submitUploads() {
+		uint64_t uploadValue = uploadManager.submit();
+		if (uploadValue != 0) {
+			pendingUploadValue = uploadValue;
+		}
+	}
+
 	void createTextureImage() {
+		if (textureCompressionBC && assetExists(COMPRESSED_TEXTURE_PATH)) {
+			createCompressedTextureImage();
+		}
+		else {
+			createUncompressedTextureImage();
+		}
+	}
+
+	// Pre-compressed textures carry their whole mip chain, so they go up in one
+	// batch with no decode, filtering or streaming.
+	void createCompressedTextureImage() {
+		AssetView packed;
+		CompressedTexture texture = assetPack.find(COMPRESSED_TEXTURE_PATH, packed)
+			? parseKtx2(static_cast<const char*>(packed.data), packed.size, COMPRESSED_TEXTURE_PATH)
+			: loadCompressedTexture(COMPRESSED_TEXTURE_PATH);
+
+		textureFormat = texture.format;
+		textureWidth = texture.width;
+		textureHeight = texture.height;
+		textureMipLevels = static_cast<uint32_t>(texture.levels.size());
+
+		createImage(textureWidth, textureHeight, textureMipLevels, textureFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageAllocation);
+
+		uploadManager.uploadCompressedImage(textureImage, texture);
+		textureResidentMip = 0;
+	}
+
+	void createUncompressedTextureImage() {
+		std::vector<char> textureStorage;
+		AssetView textureFile = loadAsset(TEXTURE_PATH, textureStorage);
+
 		int texWidth, texHeight, texChannels;
-		stbi_uc* pixels = stbi_load("textures/texture.jpg", &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+		stbi_uc* pixels = stbi_load_from_memory(static_cast<const stbi_uc*>(textureFile.data), static_cast<int>(textureFile.size), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
 		VkDeviceSize imageSize = texWidth * texHeight * 4;
 
 		if (!pixels) {
 			throw std::runtime_error("failed to load texture image!");
 		}
 
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-		createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+		textureFormat = VK_FORMAT_R8G8B8A8_SRGB;
+		textureWidth = static_cast<uint32_t>(texWidth);
+		textureHeight = static_cast<uint32_t>(texHeight);
+		textureMipLevels = calculateMipLevels(textureWidth, textureHeight);
+
+		createImage(textureWidth, textureHeight, textureMipLevels, textureFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageAllocation);
+
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, textureFormat, &formatProperties);
+
+		if ((formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) && uploadManager.isGraphicsCapable()) {
+			uploadManager.uploadImageWithMipmaps(textureImage, pixels, imageSize, textureWidth, textureHeight, textureMipLevels);
+			textureResidentMip = 0;
+		}
+		else {
+			// Without blits the chain is filtered on the CPU and uploaded coarsest
+			// level first; the small levels go up now, the rest one per frame.
+			textureMipChain = generateMipChain(pixels, textureWidth, textureHeight);
+			textureResidentMip = textureMipLevels;
 
-		void* data;
-		vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-		memcpy(data, pixels, static_cast<size_t>(imageSize));
-		vkUnmapMemory(device, stagingBufferMemory);
+			do {
+				streamTextureMip();
+			} while (textureResidentMip > 0 && std::max(mipExtent(textureWidth, textureResidentMip - 1), mipExtent(textureHeight, textureResidentMip - 1)) <= TEXTURE_STREAM_INITIAL_EXTENT);
+		}
 
 		stbi_image_free(pixels);
+	}
 
-		createImage(texWidth, texHeight, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
+	void streamTextureMip() {
+		uint32_t level = textureResidentMip - 1;
+		uint32_t width = mipExtent(textureWidth, level);
+		uint32_t height = mipExtent(textureHeight, level);
 
-		transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-		copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-		transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		uploadManager.uploadImage(textureImage, textureMipChain[level].data(), textureMipChain[level].size(), width, height, level);
 
-		vkDestroyBuffer(device, stagingBuffer, nullptr);
-		vkFreeMemory(device, stagingBufferMemory, nullptr);
+		std::vector<uint8_t>().swap(textureMipChain[level]);
+		textureResidentMip = level;
+	}
+
+	// Uploads the next finer mip level and widens the texture view to include it.
+	// The frame's submission waits on the upload, so the new view is safe to use
+	// right away; the old one and its bindless slot are released once the
+	// timeline passes the last frame submitted with them.
+	void updateTextureStreaming() {
+		if (textureResidentMip == 0) {
+			return;
+		}
+
+		streamTextureMip();
+
+		uint32_t retiredHandle = textureHandle;
+		deletionQueue.destroyImageView(submittedFrameValue, textureImageView);
+		deletionQueue.push(submittedFrameValue, [this, retiredHandle]() {
+			bindlessTable.removeTexture(retiredHandle);
+		});
+
+		createTextureImageView();
+		textureHandle = bindlessTable.addTexture(textureImageView, textureSampler);
+	}
+
+	void createSceneTextures() {
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, VK_FORMAT_R8G8B8A8_SRGB, &formatProperties);
+		bool blitMipmaps = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) && uploadManager.isGraphicsCapable();
+
+		uint32_t extent = SCENE_TEXTURE_EXTENT;
+		uint32_t mipLevels = calculateMipLevels(extent, extent);
+		std::vector<uint8_t> pixels(static_cast<size_t>(extent) * extent * 4);
+
+		for (uint32_t i = 0; i < options.sceneTextureCount; i++) {
+			// Checkerboards tinted per texture, so every one has distinct contents.
+			uint8_t tint[3] = { static_cast<uint8_t>(i * 67), static_cast<uint8_t>(i * 131), static_cast<uint8_t>(i * 197) };
+			for (uint32_t y = 0; y < extent; y++) {
+				for (uint32_t x = 0; x < extent; x++) {
+					uint8_t* pixel = &pixels[(static_cast<size_t>(y) * extent + x) * 4];
+					bool light = ((x / 32) + (y / 32)) % 2 == 0;
+					for (uint32_t c = 0; c < 3; c++) {
+						pixel[c] = light ? static_cast<uint8_t>(128 + tint[c] / 2) : static_cast<uint8_t>(tint[c] / 4);
+					}
+					pixel[3] = 255;
+				}
+			}
+
+			VkImage image;
+			Allocation imageAllocation;
+			createImage(extent, extent, mipLevels, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageAllocation);
+
+			if (blitMipmaps) {
+				uploadManager.uploadImageWithMipmaps(image, pixels.data(), pixels.size(), extent, extent, mipLevels);
+			}
+			else {
+				std::vector<std::vector<uint8_t>> mipChain = generateMipChain(pixels.data(), extent, extent);
+				for (uint32_t level = 0; level < mipLevels; level++) {
+					uploadManager.uploadImage(image, mipChain[level].data(), mipChain[level].size(), mipExtent(extent, level), mipExtent(extent, level), level);
+				}
+			}
+
+			sceneTextureImages.push_back(image);
+			sceneTextureImagesAllocation.push_back(imageAllocation);
+			sceneTextureImageViews.push_back(createImageView(image, VK_FORMAT_R8G8B8A8_SRGB, 0, mipLevels));
+			sceneTextureHandles.push_back(bindlessTable.addTexture(sceneTextureImageViews.back(), textureSampler));
+		}
 	}
 
 	void createTextureImageView() {
-		textureImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB);
+		textureImageView = createImageView(textureImage, textureFormat, textureResidentMip, textureMipLevels - textureResidentMip);
 	}
 
 	void createTextureSampler() {
@@ -765,21 +1791,24 @@ private:
 		samplerInfo.compareEnable = VK_FALSE;
 		samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
 		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+		samplerInfo.minLod = 0.0f;
+		samplerInfo.maxLod = static_cast<float>(textureMipLevels);
+		samplerInfo.mipLodBias = 0.0f;
 
 		if (vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create texture sampler!");
 		}
 	}
 
-	VkImageView createImageView(VkImage image, VkFormat format) {
+	VkImageView createImageView(VkImage image, VkFormat format, uint32_t baseMipLevel, uint32_t levelCount) {
 		VkImageViewCreateInfo viewInfo{};
 		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 		viewInfo.image = image;
 		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
 		viewInfo.format = format;
 		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		viewInfo.subresourceRange.baseMipLevel = 0;
-		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.baseMipLevel = baseMipLevel;
+		viewInfo.subresourceRange.levelCount = levelCount;
 		viewInfo.subresourceRange.baseArrayLayer = 0;
 		viewInfo.subresourceRange.layerCount = 1;
 
@@ -791,21 +1820,29 @@ private:
 		return imageView;
 	}
 
-	void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+	void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, Allocation& imageAllocation) {
 		VkImageCreateInfo imageInfo{};
 		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 		imageInfo.imageType = VK_IMAGE_TYPE_2D;
 		imageInfo.extent.width = width;
 		imageInfo.extent.height = height;
 		imageInfo.extent.depth = 1;
-		imageInfo.mipLevels = 1;
+		imageInfo.mipLevels = mipLevels;
 		imageInfo.arrayLayers = 1;
 		imageInfo.format = format;
 		imageInfo.tiling = tiling;
 		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 		imageInfo.usage = usage;
 		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (resourceQueueFamilies.size() > 1) {
+			imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(resourceQueueFamilies.size());
+			imageInfo.pQueueFamilyIndices = resourceQueueFamilies.data();
+		}
+		else {
+			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		}
 
 		if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create image!");
@@ -814,198 +1851,321 @@ private:
 		VkMemoryRequirements memRequirements;
 		vkGetImageMemoryRequirements(device, image, &memRequirements);
 
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+		imageAllocation = memoryAllocator.allocate(memRequirements, memoryAllocator.findMemoryType(memRequirements.memoryTypeBits, properties), tiling == VK_IMAGE_TILING_LINEAR);
 
-		if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-			throw std::runtime_error("failed to allocate image memory!");
+		vkBindImageMemory(device, image, imageAllocation.memory, imageAllocation.offset);
+	}
+
+	// The builtin quad, a packed .vtmesh, or an .obj that is converted on the
+	// spot and saved as .vtmesh next to it for the next run. Converted meshes use
+	// the --vertex-format encoding; .vtmesh files keep the one they were written in.
+	void loadMesh() {
+		std::string name = options.meshPath;
+		AssetView file;
+
+		if (name.empty()) {
+			name = "builtin quad";
+			meshStorage = buildMeshFile(vertices, indices, computeBoundingSphere(&vertices[0].pos, sizeof(Vertex), vertices.size()));
+			file.data = meshStorage.data();
+			file.size = meshStorage.size();
+		}
+		else if (name.size() >= 4 && name.compare(name.size() - 4, 4, ".obj") == 0) {
+			meshStorage = convertObjMesh(name);
+			file.data = meshStorage.data();
+			file.size = meshStorage.size();
+
+			std::string meshFilePath = name.substr(0, name.size() - 4) + ".vtmesh";
+			std::ofstream output(meshFilePath, std::ios::binary | std::ios::trunc);
+			if (output.write(meshStorage.data(), meshStorage.size())) {
+				std::cout << "wrote " << meshFilePath << " (" << meshStorage.size() << " bytes)" << std::endl;
+			}
+		}
+		else {
+			file = loadAsset(name, meshStorage);
 		}
 
-		vkBindImageMemory(device, image, imageMemory, 0);
-	}
+		mesh = parseMeshFile(file.data, file.size, name);
 
-	void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout) {
-		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+		if (!isValidVertexFormat(mesh.vertexFormat) || getVertexStride(static_cast<VertexFormat>(mesh.vertexFormat)) != mesh.vertexStride) {
+			throw std::runtime_error(name + " uses an unknown vertex format!");
+		}
+	}
 
-		VkImageMemoryBarrier barrier{};
-		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		barrier.oldLayout = oldLayout;
-		barrier.newLayout = newLayout;
-		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.image = image;
-		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		barrier.subresourceRange.baseMipLevel = 0;
-		barrier.subresourceRange.levelCount = 1;
-		barrier.subresourceRange.baseArrayLayer = 0;
-		barrier.subresourceRange.layerCount = 1;
+	std::vector<char> buildMeshFile(const std::vector<Vertex>& meshVertices, const std::vector<uint32_t>& meshIndices, const glm::vec4& boundingSphere) {
+		std::vector<char> encodedVertices = encodeVertices(options.vertexFormat, meshVertices);
 
-		VkPipelineStageFlags sourceStage;
-		VkPipelineStageFlags destinationStage;
+		return writeMeshFile(encodedVertices.data(), static_cast<uint32_t>(meshVertices.size()), static_cast<uint32_t>(options.vertexFormat),
+			getVertexStride(options.vertexFormat), meshIndices, boundingSphere);
+	}
 
-		if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-			barrier.srcAccessMask = 0;
-			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	std::vector<char> convertObjMesh(const std::string& path) {
+		std::vector<char> objStorage;
+		AssetView objFile = loadAsset(path, objStorage);
+		ObjData obj = parseObj(static_cast<const char*>(objFile.data), objFile.size, path);
 
-			sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-			destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		if (obj.corners.empty()) {
+			throw std::runtime_error("no triangles in " + path + "!");
 		}
-		else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-			sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-			destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		std::vector<Vertex> meshVertices;
+		std::vector<uint32_t> meshIndices;
+		std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+
+		for (size_t i = 0; i < obj.corners.size(); i++) {
+			const ObjIndex& corner = obj.corners[i];
+
+			Vertex vertex{};
+			vertex.pos = obj.positions[corner.position];
+			vertex.color = glm::vec3(1.0f);
+
+			if (corner.normal >= 0) {
+				vertex.normal = glm::normalize(obj.normals[corner.normal]);
+			}
+			else {
+				// No normals in the file: shade flat with the face normal.
+				size_t first = i - i % 3;
+				glm::vec3 p0 = obj.positions[obj.corners[first].position];
+				glm::vec3 p1 = obj.positions[obj.corners[first + 1].position];
+				glm::vec3 p2 = obj.positions[obj.corners[first + 2].position];
+				glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+				vertex.normal = glm::length(faceNormal) > 0.0f ? glm::normalize(faceNormal) : glm::vec3(0.0f, 0.0f, 1.0f);
+			}
+
+			if (uniqueVertices.count(vertex) == 0) {
+				uniqueVertices[vertex] = static_cast<uint32_t>(meshVertices.size());
+				meshVertices.push_back(vertex);
+			}
+
+			meshIndices.push_back(uniqueVertices[vertex]);
 		}
-		else {
-			throw std::invalid_argument("unsupported layout transition!");
+
+		// Fit the mesh into the same unit the quad occupies so the instance grid
+		// and camera work for any model.
+		glm::vec4 sphere = computeBoundingSphere(&meshVertices[0].pos, sizeof(Vertex), meshVertices.size());
+		float scale = sphere.w > 0.0f ? 0.5f / sphere.w : 1.0f;
+		for (auto& vertex : meshVertices) {
+			vertex.pos = (vertex.pos - glm::vec3(sphere)) * scale;
 		}
 
-		vkCmdPipelineBarrier(
-			commandBuffer,
-			sourceStage, destinationStage,
-			0,
-			0, nullptr,
-			0, nullptr,
-			1, &barrier
-		);
+		float acmrBefore = calculateAcmr(meshIndices, meshVertices.size());
+		optimizeVertexCache(meshIndices, meshVertices.size());
+		float acmrCache = calculateAcmr(meshIndices, meshVertices.size());
+		optimizeOverdraw(meshIndices, &meshVertices[0].pos, sizeof(Vertex), meshVertices.size());
+		float acmrAfter = calculateAcmr(meshIndices, meshVertices.size());
+		optimizeVertexFetch(meshVertices, meshIndices);
 
-		endSingleTimeCommands(commandBuffer);
+		std::cout << path << ": " << obj.corners.size() << " corners -> " << meshVertices.size() << " vertices, "
+			<< meshIndices.size() / 3 << " triangles, " << getIndexSize(chooseIndexType(meshVertices.size())) * 8 << "-bit indices, "
+			<< getVertexFormatName(options.vertexFormat) << " vertices (" << getVertexStride(options.vertexFormat) << " bytes)" << std::endl;
+		std::cout << "  ACMR (" << VERTEX_CACHE_MEASURE_SIZE << " entry FIFO): " << acmrBefore << " before, "
+			<< acmrCache << " after cache optimization, " << acmrAfter << " after overdraw optimization" << std::endl;
+
+		return buildMeshFile(meshVertices, meshIndices, glm::vec4(0.0f, 0.0f, 0.0f, 0.5f));
 	}
 
-	void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
-		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+	void createVertexBuffer() {
+		VkDeviceSize bufferSize = static_cast<VkDeviceSize>(mesh.vertexStride) * mesh.vertexCount;
 
-		VkBufferImageCopy region{};
-		region.bufferOffset = 0;
-		region.bufferRowLength = 0;
-		region.bufferImageHeight = 0;
-		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		region.imageSubresource.mipLevel = 0;
-		region.imageSubresource.baseArrayLayer = 0;
-		region.imageSubresource.layerCount = 1;
-		region.imageOffset = { 0, 0, 0 };
-		region.imageExtent = {
-			width,
-			height,
-			1
-		};
+		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferAllocation);
 
-		vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+		uploadManager.uploadBuffer(vertexBuffer, mesh.vertices, bufferSize);
+	}
 
-		endSingleTimeCommands(commandBuffer);
+	void createIndexBuffer() {
+		VkDeviceSize bufferSize = static_cast<VkDeviceSize>(getIndexSize(mesh.indexType)) * mesh.indexCount;
+
+		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferAllocation);
+
+		uploadManager.uploadBuffer(indexBuffer, mesh.indices, bufferSize);
 	}
 
-	void createVertexBuffer() {
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+	std::vector<InstanceData> generateInstances() {
+		uint32_t instanceCount = std::max(options.instanceCount, 1u);
+		uint32_t gridSize = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(instanceCount))));
+		float cellSize = 2.0f / gridSize;
+		float scale = std::min(1.0f, cellSize * 0.8f);
 
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+		std::vector<InstanceData> instances(instanceCount);
+		for (uint32_t i = 0; i < instanceCount; i++) {
+			glm::vec3 center(-1.0f + cellSize * (i % gridSize + 0.5f), -1.0f + cellSize * (i / gridSize + 0.5f), 0.0f);
+			instances[i].model = glm::scale(glm::translate(glm::mat4(1.0f), center), glm::vec3(scale));
+		}
+
+		return instances;
+	}
 
-		void* data;
-		vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-		memcpy(data, vertices.data(), (size_t)bufferSize);
-		vkUnmapMemory(device, stagingBufferMemory);
+	void createInstanceBuffer() {
+		std::vector<InstanceData> instances = generateInstances();
 
-		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
+		VkDeviceSize bufferSize = sizeof(instances[0]) * instances.size();
 
-		copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, instanceBuffer, instanceBufferAllocation);
 
-		vkDestroyBuffer(device, stagingBuffer, nullptr);
-		vkFreeMemory(device, stagingBufferMemory, nullptr);
+		uploadManager.uploadBuffer(instanceBuffer, instances.data(), bufferSize);
 	}
 
-	void createIndexBuffer() {
-		VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+	// Splits the instances evenly over the requested number of draws and hands
+	// the pipeline variants out in contiguous runs, the way a renderer sorted by
+	// state would issue them.
+	void createDrawList() {
+		uint32_t instanceCount = std::max(options.instanceCount, 1u);
+		uint32_t drawCount = std::min(std::max(options.drawCount, 1u), instanceCount);
+		uint32_t variantCount = static_cast<uint32_t>(pipelineVariants.size());
+
+		for (uint32_t i = 0; i < drawCount; i++) {
+			uint32_t firstInstance = static_cast<uint32_t>(static_cast<uint64_t>(instanceCount) * i / drawCount);
+			uint32_t lastInstance = static_cast<uint32_t>(static_cast<uint64_t>(instanceCount) * (i + 1) / drawCount);
+			uint32_t variant = static_cast<uint32_t>(static_cast<uint64_t>(variantCount) * i / drawCount);
+			drawItems.push_back({ mesh.indexCount, lastInstance - firstInstance, 0, 0, firstInstance, variant, getDrawTint(i, drawCount) });
+			maxDrawInstanceCount = std::max(maxDrawInstanceCount, lastInstance - firstInstance);
+		}
+
+		createIndirectBuffer(drawItems, indirectBuffer, indirectBufferAllocation, true);
+	}
+
+	// Draws share one mesh, so a tint per draw is what tells them apart on screen.
+	static glm::vec4 getDrawTint(uint32_t draw, uint32_t drawCount) {
+		if (drawCount == 1) {
+			return glm::vec4(1.0f);
+		}
+
+		float hue = 6.0f * draw / drawCount;
+		glm::vec3 color = glm::clamp(glm::vec3(std::abs(hue - 3.0f) - 1.0f, 2.0f - std::abs(hue - 2.0f), 2.0f - std::abs(hue - 4.0f)), 0.0f, 1.0f);
+		return glm::vec4(0.5f + 0.5f * color, 1.0f);
+	}
+
+	uint32_t getDrawTexture(uint32_t draw) const {
+		if (sceneTextureHandles.empty()) {
+			return textureHandle;
+		}
 
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+		return sceneTextureHandles[draw % sceneTextureHandles.size()];
+	}
+
+	void createIndirectBuffer(const std::vector<DrawItem>& draws, VkBuffer& buffer, Allocation& bufferAllocation, bool clearInstanceCounts = false) {
+		std::vector<VkDrawIndexedIndirectCommand> commands(draws.size());
+		for (size_t i = 0; i < draws.size(); i++) {
+			commands[i].indexCount = draws[i].indexCount;
+			commands[i].instanceCount = clearInstanceCounts ? 0 : draws[i].instanceCount;
+			commands[i].firstIndex = draws[i].firstIndex;
+			commands[i].vertexOffset = draws[i].vertexOffset;
+			commands[i].firstInstance = draws[i].firstInstance;
+		}
+
+		VkDeviceSize bufferSize = sizeof(commands[0]) * commands.size();
+
+		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferAllocation);
+
+		uploadManager.uploadBuffer(buffer, commands.data(), bufferSize);
+	}
 
-		void* data;
-		vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-		memcpy(data, indices.data(), (size_t)bufferSize);
-		vkUnmapMemory(device, stagingBufferMemory);
+	void createCullBuffers() {
+		meshBoundingSphere = mesh.boundingSphere;
 
-		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
+		VkDeviceSize instanceBufferSize = sizeof(InstanceData) * std::max(options.instanceCount, 1u);
+		VkDeviceSize indirectBufferSize = sizeof(VkDrawIndexedIndirectCommand) * drawItems.size();
 
-		copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+		visibleInstanceBuffers.resize(options.framesInFlight);
+		visibleInstanceBuffersAllocation.resize(options.framesInFlight);
+		culledIndirectBuffers.resize(options.framesInFlight);
+		culledIndirectBuffersAllocation.resize(options.framesInFlight);
+		cullDrawBuffers.resize(options.framesInFlight);
+		cullDrawBuffersAllocation.resize(options.framesInFlight);
 
-		vkDestroyBuffer(device, stagingBuffer, nullptr);
-		vkFreeMemory(device, stagingBufferMemory, nullptr);
+		for (size_t i = 0; i < options.framesInFlight; i++) {
+			createBuffer(instanceBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, visibleInstanceBuffers[i], visibleInstanceBuffersAllocation[i]);
+			createBuffer(indirectBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, culledIndirectBuffers[i], culledIndirectBuffersAllocation[i]);
+			createBuffer(sizeof(CullDrawData) * drawItems.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, cullDrawBuffers[i], cullDrawBuffersAllocation[i]);
+		}
 	}
 
 	void createUniformBuffers() {
 		VkDeviceSize bufferSize = sizeof(UniformBufferObject);
 
-		uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-		uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
-		uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+		uniformBuffers.resize(options.framesInFlight);
+		uniformBuffersAllocation.resize(options.framesInFlight);
+		uniformBuffersMapped.resize(options.framesInFlight);
 
-		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-			createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersMemory[i]);
+		for (size_t i = 0; i < options.framesInFlight; i++) {
+			createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersAllocation[i]);
 
-			vkMapMemory(device, uniformBuffersMemory[i], 0, bufferSize, 0, &uniformBuffersMapped[i]);
+			uniformBuffersMapped[i] = uniformBuffersAllocation[i].mapped;
 		}
+
+		createObjectUniformBuffers();
 	}
 
-	void createDescriptorPool() {
-		VkDescriptorPoolSize poolSize{};
-		poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		poolSize.descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+	// Per-draw data for every draw lives in one persistently mapped buffer per
+	// frame, so a draw only changes its dynamic offset instead of needing its
+	// own descriptor set.
+	void createObjectUniformBuffers() {
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
 
-		VkDescriptorPoolCreateInfo poolInfo{};
-		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-		poolInfo.poolSizeCount = 1;
-		poolInfo.pPoolSizes = &poolSize;
-		poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+		VkDeviceSize alignment = properties.limits.minUniformBufferOffsetAlignment;
+		objectUniformStride = (sizeof(ObjectUniforms) + alignment - 1) / alignment * alignment;
 
-		if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create descriptor pool!");
+		size_t objectCount = drawItems.size();
+		if (options.benchmarkRecording) {
+			objectCount = std::max<size_t>(objectCount, BENCHMARK_DRAW_COUNT);
 		}
-	}
 
-	void createDescriptorSets() {
-		std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
-		VkDescriptorSetAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		allocInfo.descriptorPool = descriptorPool;
-		allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-		allocInfo.pSetLayouts = layouts.data();
+		objectUniformBuffers.resize(options.framesInFlight);
+		objectUniformBuffersAllocation.resize(options.framesInFlight);
 
-		descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
-		if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
-			throw std::runtime_error("failed to allocate descriptor sets!");
+		for (size_t i = 0; i < options.framesInFlight; i++) {
+			createBuffer(objectUniformStride * objectCount, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, objectUniformBuffers[i], objectUniformBuffersAllocation[i]);
 		}
+	}
 
-		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-			VkDescriptorBufferInfo bufferInfo{};
-			bufferInfo.buffer = uniformBuffers[i];
-			bufferInfo.offset = 0;
-			bufferInfo.range = sizeof(UniformBufferObject);
+	void createDescriptorAllocators() {
+		// Per set, averaged over the graphics and culling layouts.
+		std::vector<DescriptorPoolRatio> ratios = {
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f },
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 0.5f },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f },
+		};
 
-			VkWriteDescriptorSet descriptorWrite{};
-			descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrite.dstSet = descriptorSets[i];
-			descriptorWrite.dstBinding = 0;
-			descriptorWrite.dstArrayElement = 0;
-			descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			descriptorWrite.descriptorCount = 1;
-			descriptorWrite.pBufferInfo = &bufferInfo;
+		frameDescriptorAllocators.resize(options.framesInFlight);
+		frameDescriptorCaches.resize(options.framesInFlight);
 
-			vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+		for (size_t i = 0; i < options.framesInFlight; i++) {
+			frameDescriptorAllocators[i].init(device, DESCRIPTOR_POOL_INITIAL_SETS, ratios);
+			frameDescriptorCaches[i].init(&frameDescriptorAllocators[i]);
 		}
 	}
 
-	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+	VkDescriptorSet getDescriptorSet(uint32_t frame) {
+		return frameDescriptorCaches[frame].get(descriptorSetLayout, {
+			bufferBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uniformBuffers[frame], sizeof(UniformBufferObject)),
+			bufferBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, objectUniformBuffers[frame], sizeof(ObjectUniforms)),
+		});
+	}
+
+	VkDescriptorSet getCullDescriptorSet(uint32_t frame) {
+		return frameDescriptorCaches[frame].get(cullDescriptorSetLayout, {
+			bufferBinding(getCullDescriptorType(0), uniformBuffers[frame], sizeof(UniformBufferObject)),
+			bufferBinding(getCullDescriptorType(1), instanceBuffer, VK_WHOLE_SIZE),
+			bufferBinding(getCullDescriptorType(2), visibleInstanceBuffers[frame], VK_WHOLE_SIZE),
+			bufferBinding(getCullDescriptorType(3), culledIndirectBuffers[frame], VK_WHOLE_SIZE),
+			bufferBinding(getCullDescriptorType(4), cullDrawBuffers[frame], VK_WHOLE_SIZE),
+		});
+	}
+
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& bufferAllocation) {
 		VkBufferCreateInfo bufferInfo{};
 		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 		bufferInfo.size = size;
 		bufferInfo.usage = usage;
-		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (resourceQueueFamilies.size() > 1) {
+			bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(resourceQueueFamilies.size());
+			bufferInfo.pQueueFamilyIndices = resourceQueueFamilies.data();
+		}
+		else {
+			bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		}
 
 		if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create buffer!");
@@ -1014,16 +2174,9 @@ private:
 		VkMemoryRequirements memRequirements;
 		vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+		bufferAllocation = memoryAllocator.allocate(memRequirements, memoryAllocator.findMemoryType(memRequirements.memoryTypeBits, properties), true);
 
-		if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-			throw std::runtime_error("failed to allocate buffer memory!");
-		}
-
-		vkBindBufferMemory(device, buffer, bufferMemory, 0);
+		vkBindBufferMemory(device, buffer, bufferAllocation.memory, bufferAllocation.offset);
 	}
 
 	VkCommandBuffer beginSingleTimeCommands() {
@@ -1069,21 +2222,428 @@ private:
 		endSingleTimeCommands(commandBuffer);
 	}
 
-	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-		VkPhysicalDeviceMemoryProperties memProperties;
-		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+	void benchmarkUploads() {
+		std::vector<char> payload(static_cast<size_t>(BENCHMARK_UPLOAD_SIZE), 0x5a);
+		std::vector<VkBuffer> buffers(BENCHMARK_UPLOAD_COUNT);
+		std::vector<Allocation> bufferAllocations(BENCHMARK_UPLOAD_COUNT);
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		for (uint32_t i = 0; i < BENCHMARK_UPLOAD_COUNT; i++) {
+			VkBuffer stagingBuffer;
+			Allocation stagingBufferAllocation;
+			createBuffer(BENCHMARK_UPLOAD_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferAllocation);
+			memcpy(stagingBufferAllocation.mapped, payload.data(), payload.size());
+
+			createBuffer(BENCHMARK_UPLOAD_SIZE, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffers[i], bufferAllocations[i]);
+			copyBuffer(stagingBuffer, buffers[i], BENCHMARK_UPLOAD_SIZE);
+
+			vkDestroyBuffer(device, stagingBuffer, nullptr);
+			memoryAllocator.free(stagingBufferAllocation);
+		}
+
+		auto singleTimeEnd = std::chrono::high_resolution_clock::now();
+
+		for (uint32_t i = 0; i < BENCHMARK_UPLOAD_COUNT; i++) {
+			uploadManager.uploadBuffer(buffers[i], payload.data(), BENCHMARK_UPLOAD_SIZE);
+		}
+		uploadManager.submit();
+		uploadManager.waitIdle();
+
+		auto batchedEnd = std::chrono::high_resolution_clock::now();
+
+		for (uint32_t i = 0; i < BENCHMARK_UPLOAD_COUNT; i++) {
+			vkDestroyBuffer(device, buffers[i], nullptr);
+			memoryAllocator.free(bufferAllocations[i]);
+		}
+
+		float singleTimeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(singleTimeEnd - startTime).count();
+		float batchedMs = std::chrono::duration<float, std::chrono::milliseconds::period>(batchedEnd - singleTimeEnd).count();
+
+		std::cout << "upload benchmark: " << BENCHMARK_UPLOAD_COUNT << " buffers of " << BENCHMARK_UPLOAD_SIZE / 1024 << " KiB" << std::endl;
+		std::cout << "  single-time commands: " << singleTimeMs << " ms" << std::endl;
+		std::cout << "  batched upload:       " << batchedMs << " ms" << std::endl;
+		std::cout << "  staged through ring:  " << uploadManager.getStagingRing().getBytesStagedTotal() / 1024 << " KiB" << std::endl;
+		vkDeviceWaitIdle(device);
+	}
+
+	void benchmarkRecording() {
+		std::vector<DrawItem> benchmarkDraws(BENCHMARK_DRAW_COUNT, drawItems[0]);
+		std::swap(drawItems, benchmarkDraws);
+		resolvePipelines();
+
+		VkBuffer benchmarkIndirectBuffer;
+		Allocation benchmarkIndirectBufferAllocation;
+		createIndirectBuffer(drawItems, benchmarkIndirectBuffer, benchmarkIndirectBufferAllocation);
+		uploadManager.submit();
+
+		VkCommandBufferInheritanceInfo inheritanceInfo{};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.renderPass = renderPass;
+		inheritanceInfo.subpass = 0;
+		inheritanceInfo.framebuffer = swapChainFramebuffers[0];
+
+		std::cout << "recording benchmark: " << BENCHMARK_DRAW_COUNT << " draws" << std::endl;
+
+		for (uint32_t threads = 1; threads <= parallelRecorder.getThreadCount(); threads++) {
+			auto startTime = std::chrono::high_resolution_clock::now();
+
+			for (uint32_t i = 0; i < BENCHMARK_RECORDING_ITERATIONS; i++) {
+				parallelRecorder.record(0, inheritanceInfo, BENCHMARK_DRAW_COUNT, threads,
+					[this, benchmarkIndirectBuffer](VkCommandBuffer secondary, uint32_t begin, uint32_t end) {
+						recordDraws(secondary, 0, instanceBuffer, benchmarkIndirectBuffer, begin, end);
+					}, secondaryCommandBuffers);
+			}
+
+			auto endTime = std::chrono::high_resolution_clock::now();
+			float recordMs = std::chrono::duration<float, std::chrono::milliseconds::period>(endTime - startTime).count() / BENCHMARK_RECORDING_ITERATIONS;
+
+			std::cout << "  " << threads << " thread(s): " << recordMs << " ms" << std::endl;
+		}
+
+		std::swap(drawItems, benchmarkDraws);
+
+		uploadManager.waitIdle();
+		vkDestroyBuffer(device, benchmarkIndirectBuffer, nullptr);
+		memoryAllocator.free(benchmarkIndirectBufferAllocation);
+	}
+
+	// Loads the texture through both paths into throwaway images and reports
+	// how long each takes to reach the GPU and how much device memory it uses.
+	void compareTextureFormats() {
+		std::cout << "texture format comparison:" << std::endl;
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		int texWidth, texHeight, texChannels;
+		stbi_uc* pixels = stbi_load(TEXTURE_PATH.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+		if (!pixels) {
+			throw std::runtime_error("failed to load texture image!");
+		}
+
+		uint32_t width = static_cast<uint32_t>(texWidth);
+		uint32_t height = static_cast<uint32_t>(texHeight);
+		std::vector<std::vector<uint8_t>> mipChain = generateMipChain(pixels, width, height);
+		stbi_image_free(pixels);
+
+		auto loadEnd = std::chrono::high_resolution_clock::now();
+
+		VkImage image;
+		Allocation imageAllocation;
+		createImage(width, height, static_cast<uint32_t>(mipChain.size()), VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageAllocation);
+
+		for (uint32_t level = 0; level < mipChain.size(); level++) {
+			uploadManager.uploadImage(image, mipChain[level].data(), mipChain[level].size(), mipExtent(width, level), mipExtent(height, level), level);
+		}
+		uploadManager.submit();
+		uploadManager.waitIdle();
+
+		auto uploadEnd = std::chrono::high_resolution_clock::now();
+
+		printTextureComparison("RGBA8 (" + TEXTURE_PATH + ")", startTime, loadEnd, uploadEnd, imageAllocation.size);
+
+		vkDestroyImage(device, image, nullptr);
+		memoryAllocator.free(imageAllocation);
+
+		if (!textureCompressionBC) {
+			std::cout << "  BCn: not supported by this device" << std::endl;
+			return;
+		}
+		if (!std::ifstream(COMPRESSED_TEXTURE_PATH).good()) {
+			std::cout << "  BCn: " << COMPRESSED_TEXTURE_PATH << " not found, generate it with TextureConverter" << std::endl;
+			return;
+		}
+
+		startTime = std::chrono::high_resolution_clock::now();
+
+		CompressedTexture texture = loadCompressedTexture(COMPRESSED_TEXTURE_PATH);
+
+		loadEnd = std::chrono::high_resolution_clock::now();
+
+		createImage(texture.width, texture.height, static_cast<uint32_t>(texture.levels.size()), texture.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageAllocation);
+
+		uploadManager.uploadCompressedImage(image, texture);
+		uploadManager.submit();
+		uploadManager.waitIdle();
+
+		uploadEnd = std::chrono::high_resolution_clock::now();
+
+		printTextureComparison("BCn (" + COMPRESSED_TEXTURE_PATH + ")", startTime, loadEnd, uploadEnd, imageAllocation.size);
+
+		vkDestroyImage(device, image, nullptr);
+		memoryAllocator.free(imageAllocation);
+	}
+
+	void printTextureComparison(const std::string& name, std::chrono::high_resolution_clock::time_point startTime,
+		std::chrono::high_resolution_clock::time_point loadEnd, std::chrono::high_resolution_clock::time_point uploadEnd, VkDeviceSize deviceBytes) {
+		float loadMs = std::chrono::duration<float, std::chrono::milliseconds::period>(loadEnd - startTime).count();
+		float uploadMs = std::chrono::duration<float, std::chrono::milliseconds::period>(uploadEnd - loadEnd).count();
+
+		std::cout << "  " << name << std::endl;
+		std::cout << "    load:   " << loadMs << " ms" << std::endl;
+		std::cout << "    upload: " << uploadMs << " ms" << std::endl;
+		std::cout << "    memory: " << deviceBytes / 1024 << " KiB" << std::endl;
+	}
+
+	// Decodes and uploads the same image BENCHMARK_TEXTURE_COUNT times with an
+	// increasing number of decode workers.
+	void benchmarkTextureLoading() {
+		std::vector<std::string> paths(BENCHMARK_TEXTURE_COUNT, TEXTURE_PATH);
+
+		auto createTexture = [this](uint32_t width, uint32_t height, VkImage& image, Allocation& imageAllocation) {
+			createImage(width, height, 1, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageAllocation);
+		};
+
+		std::cout << "texture loading benchmark: " << BENCHMARK_TEXTURE_COUNT << " x " << TEXTURE_PATH << std::endl;
+
+		std::vector<uint32_t> workerCounts;
+		for (uint32_t workers = 1; workers < threadPool.getThreadCount(); workers *= 2) {
+			workerCounts.push_back(workers);
+		}
+		workerCounts.push_back(threadPool.getThreadCount());
+
+		float singleThreadMs = 0.0f;
+		for (uint32_t workers : workerCounts) {
+			auto startTime = std::chrono::high_resolution_clock::now();
+
+			std::vector<LoadedTexture> textures = textureLoader.load(paths, workers, createTexture);
+			uploadManager.submit();
+			uploadManager.waitIdle();
+
+			auto endTime = std::chrono::high_resolution_clock::now();
+			float loadMs = std::chrono::duration<float, std::chrono::milliseconds::period>(endTime - startTime).count();
+			if (workers == 1) {
+				singleThreadMs = loadMs;
+			}
+
+			std::cout << "  " << workers << " worker(s): " << loadMs << " ms (" << singleThreadMs / loadMs << "x)" << std::endl;
+
+			for (auto& texture : textures) {
+				vkDestroyImage(device, texture.image, nullptr);
+				memoryAllocator.free(texture.allocation);
+			}
+		}
+	}
+
+	// Encodes and uploads BENCHMARK_VERTEX_COUNT sphere vertices in every vertex
+	// format and reports the device memory each one needs against full floats,
+	// along with the precision it gives up.
+	void benchmarkVertexFormats() {
+		std::vector<Vertex> source(BENCHMARK_VERTEX_COUNT);
+		for (uint32_t i = 0; i < BENCHMARK_VERTEX_COUNT; i++) {
+			float z = 1.0f - 2.0f * (i + 0.5f) / BENCHMARK_VERTEX_COUNT;
+			float radius = std::sqrt(1.0f - z * z);
+			float angle = 2.39996323f * i;
+			glm::vec3 normal(radius * std::cos(angle), radius * std::sin(angle), z);
+
+			source[i].pos = normal * 0.5f;
+			source[i].normal = normal;
+			source[i].color = normal * 0.5f + 0.5f;
+		}
+
+		std::cout << "vertex format comparison: " << BENCHMARK_VERTEX_COUNT << " vertices" << std::endl;
+
+		VkDeviceSize floatBytes = 0;
+		for (VertexFormat format : ALL_VERTEX_FORMATS) {
+			auto startTime = std::chrono::high_resolution_clock::now();
+
+			std::vector<char> encoded = encodeVertices(format, source);
+
+			auto encodeEnd = std::chrono::high_resolution_clock::now();
+
+			VkBuffer buffer;
+			Allocation bufferAllocation;
+			createBuffer(encoded.size(), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferAllocation);
+
+			uploadManager.uploadBuffer(buffer, encoded.data(), encoded.size());
+			uploadManager.submit();
+			uploadManager.waitIdle();
+
+			auto uploadEnd = std::chrono::high_resolution_clock::now();
+
+			float positionError = 0.0f;
+			float normalErrorDegrees = 0.0f;
+			visitVertexFormat(format, [&](auto vertex) {
+				using Layout = decltype(vertex);
+				const Layout* decoded = reinterpret_cast<const Layout*>(encoded.data());
+				for (uint32_t i = 0; i < BENCHMARK_VERTEX_COUNT; i++) {
+					positionError = std::max(positionError, glm::length(decoded[i].position.decode() - source[i].pos));
+					float cosine = std::min(std::max(glm::dot(glm::normalize(decoded[i].normal.decode()), source[i].normal), -1.0f), 1.0f);
+					normalErrorDegrees = std::max(normalErrorDegrees, glm::degrees(std::acos(cosine)));
+				}
+			});
+
+			if (format == VertexFormat::Float) {
+				floatBytes = bufferAllocation.size;
+			}
+
+			float encodeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(encodeEnd - startTime).count();
+			float uploadMs = std::chrono::duration<float, std::chrono::milliseconds::period>(uploadEnd - encodeEnd).count();
+			double mibPerMillion = getVertexStride(format) * 1000000.0 / (1024.0 * 1024.0);
+			double savedPerMillion = (getVertexStride(VertexFormat::Float) - getVertexStride(format)) * 1000000.0 / (1024.0 * 1024.0);
+
+			std::cout << "  " << getVertexFormatName(format) << " (" << getVertexStride(format) << " bytes/vertex)" << std::endl;
+			std::cout << "    memory: " << bufferAllocation.size / 1024 << " KiB (" << static_cast<double>(floatBytes) / bufferAllocation.size << "x smaller)" << std::endl;
+			std::cout << "    per million vertices: " << mibPerMillion << " MiB, " << savedPerMillion << " MiB saved" << std::endl;
+			std::cout << "    encode: " << encodeMs << " ms, upload: " << uploadMs << " ms" << std::endl;
+			std::cout << "    max error: position " << positionError << ", normal " << normalErrorDegrees << " degrees" << std::endl;
+
+			vkDestroyBuffer(device, buffer, nullptr);
+			memoryAllocator.free(bufferAllocation);
+		}
+	}
+
+	void verifyCulling() {
+		updateUniformBuffer(0);
+
+		VkDeviceSize readbackSize = sizeof(VkDrawIndexedIndirectCommand) * drawItems.size();
+		VkBuffer readbackBuffer;
+		Allocation readbackBufferAllocation;
+		createBuffer(readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, readbackBuffer, readbackBufferAllocation);
+
+		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+
+		recordCulling(commandBuffer, 0);
+
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		VkBufferCopy copyRegion{};
+		copyRegion.size = readbackSize;
+		vkCmdCopyBuffer(commandBuffer, culledIndirectBuffers[0], readbackBuffer, 1, &copyRegion);
+
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		vkEndCommandBuffer(commandBuffer);
+
+		VkSemaphore uploadSemaphore = uploadManager.getTimelineSemaphore();
+		VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.waitSemaphoreValueCount = 1;
+		timelineInfo.pWaitSemaphoreValues = &pendingUploadValue;
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &timelineInfo;
+		submitInfo.waitSemaphoreCount = pendingUploadValue != 0 ? 1 : 0;
+		submitInfo.pWaitSemaphores = &uploadSemaphore;
+		submitInfo.pWaitDstStageMask = &waitStage;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+
+		vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+		vkQueueWaitIdle(graphicsQueue);
+
+		vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+		pendingUploadValue = 0;
+
+		UniformBufferObject ubo;
+		memcpy(&ubo, uniformBuffersMapped[0], sizeof(ubo));
+		const CullDrawData* cullDraws = static_cast<const CullDrawData*>(cullDrawBuffersAllocation[0].mapped);
+
+		std::vector<InstanceData> instances = generateInstances();
+		const VkDrawIndexedIndirectCommand* results = static_cast<const VkDrawIndexedIndirectCommand*>(readbackBufferAllocation.mapped);
+
+		bool matches = true;
+		for (size_t i = 0; i < drawItems.size(); i++) {
+			glm::mat4 viewProj = ubo.proj * ubo.view * cullDraws[i].model;
+
+			uint32_t expected = 0;
+			for (uint32_t j = 0; j < drawItems[i].instanceCount; j++) {
+				if (isSphereInFrustum(viewProj, instances[drawItems[i].firstInstance + j].model, meshBoundingSphere)) {
+					expected++;
+				}
+			}
+
+			std::cout << "draw " << i << ": " << results[i].instanceCount << " of " << drawItems[i].instanceCount << " instances visible (CPU reference " << expected << ")" << std::endl;
+			matches = matches && results[i].instanceCount == expected;
+		}
+
+		vkDestroyBuffer(device, readbackBuffer, nullptr);
+		memoryAllocator.free(readbackBufferAllocation);
+
+		if (!matches) {
+			throw std::runtime_error("GPU culling does not match the CPU reference!");
+		}
+	}
+
+	// Requests every variant through the background path and checks that each
+	// one is served by the fallback until it is compiled, then by its own
+	// pipeline.
+	void verifyPipelines() {
+		std::vector<PipelineStateDesc> variants;
+		std::vector<bool> servedByFallback;
+		for (uint32_t i = 1; i < MAX_PIPELINE_VARIANTS; i++) {
+			variants.push_back(makePipelineVariant(pipelineVariants[0], i));
+			servedByFallback.push_back(pipelineRegistry.request(variants.back(), graphicsPipeline) == graphicsPipeline);
+		}
+
+		pipelineRegistry.waitIdle();
+
+		bool matches = true;
+		std::set<VkPipeline> compiled;
+		for (size_t i = 0; i < variants.size(); i++) {
+			VkPipeline pipeline = pipelineRegistry.request(variants[i], graphicsPipeline);
+			bool swapped = pipeline != VK_NULL_HANDLE && pipeline != graphicsPipeline && compiled.insert(pipeline).second;
+
+			std::cout << "variant " << i + 1 << ": " << (servedByFallback[i] ? "fallback, then " : "") << (swapped ? "own pipeline" : "still the fallback") << std::endl;
+			matches = matches && swapped;
+		}
+
+		// Variants past the requested count were never asked for before, so those
+		// at least must have started out on the fallback.
+		for (size_t i = options.pipelineVariantCount - 1; i < variants.size(); i++) {
+			matches = matches && servedByFallback[i];
+		}
+
+		if (!matches) {
+			throw std::runtime_error("pipeline variants were not swapped in after compiling!");
+		}
+	}
+
+	static bool isSphereInFrustum(const glm::mat4& viewProj, const glm::mat4& model, const glm::vec4& boundingSphere) {
+		glm::vec4 center = model * glm::vec4(boundingSphere.x, boundingSphere.y, boundingSphere.z, 1.0f);
+		float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+		float radius = boundingSphere.w * scale;
+
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++) {
+			rows[i] = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+		}
 
-		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-			if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-				return i;
+		glm::vec4 planes[6] = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[2], rows[3] - rows[2] };
+		for (const auto& plane : planes) {
+			glm::vec3 normal(plane);
+			if (glm::dot(normal, glm::vec3(center)) + plane.w < -radius * glm::length(normal)) {
+				return false;
 			}
 		}
 
-		throw std::runtime_error("failed to find suitable memory type!");
+		return true;
+	}
+
+	void printMemoryStats() {
+		AllocatorStats stats = memoryAllocator.getStats();
+
+		std::cout << "device memory: " << stats.allocationCount << " allocations in " << stats.blockCount << " blocks, "
+			<< stats.bytesReserved / 1024 << " KiB reserved, "
+			<< stats.bytesUsed / 1024 << " KiB used, "
+			<< stats.bytesFragmented / 1024 << " KiB fragmented" << std::endl;
+	}
+
+	void printPipelineStats() {
+		std::cout << "pipeline creation: " << pipelineCreationMs << " ms (" << (pipelineCache.isWarm() ? "warm" : "cold") << " cache)" << std::endl;
 	}
 
 	void createCommandBuffers() {
-		commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+		commandBuffers.resize(options.framesInFlight);
 
 		VkCommandBufferAllocateInfo allocInfo{};
 		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -1104,6 +2664,15 @@ private:
 			throw std::runtime_error("failed to begin recording command buffer!");
 		}
 
+		profiler.resetQueries(commandBuffer);
+		uint32_t frameScope = profiler.beginGpuScope(commandBuffer, "frame");
+
+		uint32_t cullScope = profiler.beginGpuScope(commandBuffer, "cull");
+		recordCulling(commandBuffer, currentFrame);
+		profiler.endGpuScope(commandBuffer, cullScope);
+
+		uint32_t renderPassScope = profiler.beginGpuScope(commandBuffer, "render pass");
+
 		VkRenderPassBeginInfo renderPassInfo{};
 		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 		renderPassInfo.renderPass = renderPass;
@@ -1115,9 +2684,91 @@ private:
 		renderPassInfo.clearValueCount = 1;
 		renderPassInfo.pClearValues = &clearColor;
 
-		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+		VkCommandBufferInheritanceInfo inheritanceInfo{};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.renderPass = renderPass;
+		inheritanceInfo.subpass = 0;
+		inheritanceInfo.framebuffer = swapChainFramebuffers[imageIndex];
+
+		resolvePipelines();
+
+		uint32_t frame = currentFrame;
+		parallelRecorder.record(frame, inheritanceInfo, static_cast<uint32_t>(drawItems.size()), parallelRecorder.getThreadCount(),
+			[this, frame](VkCommandBuffer secondary, uint32_t begin, uint32_t end) {
+				CpuScope scope = profiler.cpuScope("record draws");
+				recordDraws(secondary, frame, visibleInstanceBuffers[frame], culledIndirectBuffers[frame], begin, end);
+			}, secondaryCommandBuffers);
+
+		if (!secondaryCommandBuffers.empty()) {
+			vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryCommandBuffers.size()), secondaryCommandBuffers.data());
+		}
+
+		vkCmdEndRenderPass(commandBuffer);
+		profiler.endGpuScope(commandBuffer, renderPassScope);
+
+		if (options.headless) {
+			uint32_t readbackScope = profiler.beginGpuScope(commandBuffer, "readback");
+			frameReadback.record(commandBuffer, swapChainImages[imageIndex], frameNumber);
+			profiler.endGpuScope(commandBuffer, readbackScope);
+		}
+
+		profiler.endGpuScope(commandBuffer, frameScope);
+
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record command buffer!");
+		}
+	}
+
+	// Resets every indirect command's instance count from the template and lets
+	// the compute pass append the instances that survive frustum culling. All
+	// draws are culled by one dispatch, a row of workgroups per draw; draws whose
+	// instances are all culled keep their command with an instance count of zero.
+	void recordCulling(VkCommandBuffer commandBuffer, uint32_t frame) {
+		VkBufferCopy copyRegion{};
+		copyRegion.size = sizeof(VkDrawIndexedIndirectCommand) * drawItems.size();
+		vkCmdCopyBuffer(commandBuffer, indirectBuffer, culledIndirectBuffers[frame], 1, &copyRegion);
+
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+
+		VkDescriptorSet cullDescriptorSet = getCullDescriptorSet(frame);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &cullDescriptorSet, 0, nullptr);
+
+		uint32_t drawCount = static_cast<uint32_t>(drawItems.size());
+		uint32_t groupCountX = (maxDrawInstanceCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE;
+
+		// Only split when the draw count exceeds the device's workgroup count in y.
+		for (uint32_t firstDraw = 0; firstDraw < drawCount; firstDraw += maxCullDispatchDraws) {
+			CullPushConstants pushConstants{};
+			pushConstants.boundingSphere = meshBoundingSphere;
+			pushConstants.firstDraw = firstDraw;
+			vkCmdPushConstants(commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+
+			vkCmdDispatch(commandBuffer, groupCountX, std::min(drawCount - firstDraw, maxCullDispatchDraws), 1);
+		}
+
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	// Variants that are still compiling are drawn with the base pipeline, which
+	// shares their layout and render pass.
+	void resolvePipelines() {
+		resolvedPipelines.resize(pipelineVariants.size());
+		for (size_t i = 0; i < pipelineVariants.size(); i++) {
+			resolvedPipelines[i] = pipelineRegistry.request(pipelineVariants[i], graphicsPipeline);
+		}
+	}
+
+	void recordDraws(VkCommandBuffer commandBuffer, uint32_t frame, VkBuffer instances, VkBuffer commands, uint32_t begin, uint32_t end) {
 
 		VkViewport viewport{};
 		viewport.x = 0.0f;
@@ -1133,42 +2784,38 @@ private:
 		scissor.extent = swapChainExtent;
 		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-		VkBuffer vertexBuffers[] = { vertexBuffer };
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+		VkBuffer vertexBuffers[] = { vertexBuffer, instances };
+		VkDeviceSize offsets[] = { 0, 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
 
-		vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+		vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, mesh.indexType);
 
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
+		VkDescriptorSet bindlessSet = bindlessTable.getSet();
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &bindlessSet, 0, nullptr);
 
-		vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+		VkDescriptorSet descriptorSet = getDescriptorSet(frame);
+		VkPipeline boundPipeline = VK_NULL_HANDLE;
+		for (uint32_t i = begin; i < end; i++) {
+			VkPipeline pipeline = resolvedPipelines[drawItems[i].pipelineVariant];
+			if (pipeline != boundPipeline) {
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+				boundPipeline = pipeline;
+			}
 
-		vkCmdEndRenderPass(commandBuffer);
+			uint32_t objectOffset = static_cast<uint32_t>(objectUniformStride * i);
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 1, &objectOffset);
 
-		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
-			throw std::runtime_error("failed to record command buffer!");
+			DrawPushConstants pushConstants{};
+			pushConstants.tint = drawItems[i].tint;
+			pushConstants.textureIndex = getDrawTexture(i);
+			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushConstants), &pushConstants);
+
+			vkCmdDrawIndexedIndirect(commandBuffer, commands, sizeof(VkDrawIndexedIndirectCommand) * i, 1, sizeof(VkDrawIndexedIndirectCommand));
 		}
 	}
 
 	void createSyncObjects() {
-		imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-		renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-		inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-
-		VkSemaphoreCreateInfo semaphoreInfo{};
-		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-		VkFenceCreateInfo fenceInfo{};
-		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-		fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-			if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-				vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-				vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
-				throw std::runtime_error("failed to create synchronization objects for a frame!");
-			}
-		}
+		frameScheduler.init(device, options.framesInFlight);
 	}
 
 	void updateUniformBuffer(uint32_t currentImage) {
@@ -1176,62 +2823,168 @@ private:
 
 		auto currentTime = std::chrono::high_resolution_clock::now();
 		float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+		if (options.headless) {
+			// Fixed steps so headless output does not depend on how fast the device is.
+			time = frameNumber * HEADLESS_FRAME_TIME;
+		}
 
 		UniformBufferObject ubo{};
-		ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
 		ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
 		ubo.proj = glm::perspective(glm::radians(45.0f), swapChainExtent.width / (float)swapChainExtent.height, 0.1f, 10.0f);
 		ubo.proj[1][1] *= -1;
 
 		memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
+
+		ObjectUniforms object{};
+		object.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+
+		char* objects = static_cast<char*>(objectUniformBuffersAllocation[currentImage].mapped);
+		for (size_t i = 0; i < drawItems.size(); i++) {
+			memcpy(objects + objectUniformStride * i, &object, sizeof(object));
+		}
+
+		CullDrawData* cullDraws = static_cast<CullDrawData*>(cullDrawBuffersAllocation[currentImage].mapped);
+		for (size_t i = 0; i < drawItems.size(); i++) {
+			cullDraws[i].model = object.model;
+			cullDraws[i].firstInstance = drawItems[i].firstInstance;
+			cullDraws[i].instanceCount = drawItems[i].instanceCount;
+		}
 	}
 
 	void drawFrame() {
-		vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+		CpuScope frameScope = profiler.cpuScope("frame");
+		frameStats.beginFrame(frameNumber);
 
-		uint32_t imageIndex;
-		VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+		currentFrame = frameScheduler.getFrameIndex(frameNumber);
+		uint32_t framesInFlight = frameScheduler.getFramesInFlight();
 
-		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-			recreateSwapChain();
-			return;
+		{
+			CpuScope scope = profiler.cpuScope("wait frame slot");
+			double waitStart = frameStats.getTime();
+			frameScheduler.waitForFrameSlot(frameNumber);
+			frameStats.recordSlotWait(frameStats.getTime() - waitStart);
+		}
+		profiler.beginFrame(currentFrame);
+
+		double gpuFrameMs = profiler.getGpuFrameMs(currentFrame);
+		if (gpuFrameMs >= 0.0 && frameNumber >= framesInFlight) {
+			frameStats.recordGpuTime(frameNumber - framesInFlight, gpuFrameMs);
+		}
+
+		// Frame N signals N + 1, so every frame below the completed value has its
+		// readback in host memory, which can be ahead of the slot just waited for.
+		uint64_t completedValue = frameScheduler.getCompletedValue();
+		if (options.headless && completedValue > 0) {
+			frameReadback.collect(completedValue - 1);
+		}
+
+		uploadManager.collect();
+		uploadManager.beginFrame();
+		deletionQueue.flush(completedValue);
+
+		frameDescriptorAllocators[currentFrame].reset();
+		frameDescriptorCaches[currentFrame].clear();
+
+		{
+			CpuScope scope = profiler.cpuScope("texture streaming");
+			updateTextureStreaming();
 		}
-		else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-			throw std::runtime_error("failed to acquire swap chain image!");
+
+		// Each frame in flight owns one offscreen target, so waiting for the slot
+		// already guarantees the target is free again.
+		uint32_t imageIndex = currentFrame;
+		if (!options.headless) {
+			CpuScope scope = profiler.cpuScope("acquire");
+			double acquireStart = frameStats.getTime();
+			VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, frameScheduler.getImageAvailableSemaphore(currentFrame), VK_NULL_HANDLE, &imageIndex);
+			frameStats.recordAcquire(frameStats.getTime() - acquireStart);
+
+			if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+				recreateSwapChain();
+				return;
+			}
+			else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+				throw std::runtime_error("failed to acquire swap chain image!");
+			}
 		}
 
 		updateUniformBuffer(currentFrame);
 
-		vkResetFences(device, 1, &inFlightFences[currentFrame]);
+		{
+			CpuScope scope = profiler.cpuScope("record");
+			vkResetCommandBuffer(commandBuffers[currentFrame], /*VkCommandBufferResetFlagBits*/ 0);
+			recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+		}
+
+		CpuScope submitScope = profiler.cpuScope("submit");
 
-		vkResetCommandBuffer(commandBuffers[currentFrame], /*VkCommandBufferResetFlagBits*/ 0);
-		recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+		submitUploads();
 
 		VkSubmitInfo submitInfo{};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-		VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
-		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = waitSemaphores;
-		submitInfo.pWaitDstStageMask = waitStages;
+		// Binary semaphores ignore their entry in the value arrays.
+		std::vector<VkSemaphore> waitSemaphores;
+		std::vector<VkPipelineStageFlags> waitStages;
+		std::vector<uint64_t> waitValues;
+		if (!options.headless) {
+			waitSemaphores.push_back(frameScheduler.getImageAvailableSemaphore(currentFrame));
+			waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+			waitValues.push_back(0);
+		}
+		if (pendingUploadValue != 0) {
+			waitSemaphores.push_back(uploadManager.getTimelineSemaphore());
+			waitStages.push_back(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+			waitValues.push_back(pendingUploadValue);
+		}
+		submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+		submitInfo.pWaitSemaphores = waitSemaphores.data();
+		submitInfo.pWaitDstStageMask = waitStages.data();
 
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
 
-		VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
-		submitInfo.signalSemaphoreCount = 1;
+		VkSemaphore signalSemaphores[] = { frameScheduler.getTimelineSemaphore(), frameScheduler.getRenderFinishedSemaphore(currentFrame) };
+		uint64_t signalValues[] = { FrameScheduler::getFrameValue(frameNumber), 0 };
+		submitInfo.signalSemaphoreCount = options.headless ? 1 : 2;
 		submitInfo.pSignalSemaphores = signalSemaphores;
 
-		if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+		timelineInfo.pWaitSemaphoreValues = waitValues.data();
+		timelineInfo.signalSemaphoreValueCount = submitInfo.signalSemaphoreCount;
+		timelineInfo.pSignalSemaphoreValues = signalValues;
+		submitInfo.pNext = &timelineInfo;
+
+		profiler.markSubmit();
+		frameStats.recordStagedBytes(uploadManager.getStagingRing().getBytesStagedThisFrame());
+		frameStats.markSubmit();
+		if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
 			throw std::runtime_error("failed to submit draw command buffer!");
 		}
 
+		submittedFrameValue = FrameScheduler::getFrameValue(frameNumber);
+		pendingUploadValue = 0;
+
+		if (!options.headless) {
+			CpuScope scope = profiler.cpuScope("present");
+			present(imageIndex);
+		}
+
+		frameStats.endFrame();
+
+		frameNumber++;
+	}
+
+	void present(uint32_t imageIndex) {
+		VkSemaphore waitSemaphores[] = { frameScheduler.getRenderFinishedSemaphore(currentFrame) };
+
 		VkPresentInfoKHR presentInfo{};
 		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
 		presentInfo.waitSemaphoreCount = 1;
-		presentInfo.pWaitSemaphores = signalSemaphores;
+		presentInfo.pWaitSemaphores = waitSemaphores;
 
 		VkSwapchainKHR swapChains[] = { swapChain };
 		presentInfo.swapchainCount = 1;
@@ -1239,7 +2992,7 @@ private:
 
 		presentInfo.pImageIndices = &imageIndex;
 
-		result = vkQueuePresentKHR(presentQueue, &presentInfo);
+		VkResult result = vkQueuePresentKHR(presentQueue, &presentInfo);
 
 		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
 			framebufferResized = false;
@@ -1248,15 +3001,13 @@ private:
 		else if (result != VK_SUCCESS) {
 			throw std::runtime_error("failed to present swap chain image!");
 		}
-
-		currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 	}
 
-	VkShaderModule createShaderModule(const std::vector<char>& code) {
+	VkShaderModule createShaderModule(const AssetView& code) {
 		VkShaderModuleCreateInfo createInfo{};
 		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		createInfo.codeSize = code.size();
-		createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+		createInfo.codeSize = code.size;
+		createInfo.pCode = static_cast<const uint32_t*>(code.data);
 
 		VkShaderModule shaderModule;
 		if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
@@ -1335,8 +3086,8 @@ private:
 
 		bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-		bool swapChainAdequate = false;
-		if (extensionsSupported) {
+		bool swapChainAdequate = options.headless;
+		if (extensionsSupported && !options.headless) {
 			SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
 			swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
 		}
@@ -1344,7 +3095,30 @@ private:
 		VkPhysicalDeviceFeatures supportedFeatures;
 		vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
-		return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+		return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy &&
+			supportedFeatures.drawIndirectFirstInstance && checkVulkan12FeatureSupport(device);
+	}
+
+	// Frame pacing and uploads run on timeline semaphores and textures are bound
+	// through the bindless table, both of which need Vulkan 1.2.
+	bool checkVulkan12FeatureSupport(VkPhysicalDevice device) {
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(device, &properties);
+		if (properties.apiVersion < VK_API_VERSION_1_2) {
+			return false;
+		}
+
+		VkPhysicalDeviceVulkan12Features vulkan12Features{};
+		vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+		VkPhysicalDeviceFeatures2 features{};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features.pNext = &vulkan12Features;
+		vkGetPhysicalDeviceFeatures2(device, &features);
+
+		return vulkan12Features.timelineSemaphore && vulkan12Features.descriptorIndexing && vulkan12Features.runtimeDescriptorArray &&
+			vulkan12Features.descriptorBindingPartiallyBound && vulkan12Features.descriptorBindingSampledImageUpdateAfterBind &&
+			vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind && vulkan12Features.descriptorBindingUpdateUnusedWhilePending;
 	}
 
 	bool checkDeviceExtensionSupport(VkPhysicalDevice device) {
@@ -1354,7 +3128,8 @@ private:
 		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
 		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
-		std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+		std::vector<const char*> extensions = getDeviceExtensions();
+		std::set<std::string> requiredExtensions(extensions.begin(), extensions.end());
 
 		for (const auto& extension : availableExtensions) {
 			requiredExtensions.erase(extension.extensionName);
@@ -1374,33 +3149,53 @@ private:
 
 		int i = 0;
 		for (const auto& queueFamily : queueFamilies) {
-			if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+			if ((queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !indices.graphicsFamily.has_value()) {
 				indices.graphicsFamily = i;
 			}
 
 			VkBool32 presentSupport = false;
-			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+			if (surface != VK_NULL_HANDLE) {
+				vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+			}
 
-			if (presentSupport) {
+			if (presentSupport && !indices.presentFamily.has_value()) {
 				indices.presentFamily = i;
 			}
 
-			if (indices.isComplete()) {
-				break;
+			if ((queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+				indices.transferFamily = i;
 			}
 
 			i++;
 		}
 
+		// Without a surface nothing is presented; frames are read back on the
+		// graphics queue, which stands in for the present queue.
+		if (surface == VK_NULL_HANDLE) {
+			indices.presentFamily = indices.graphicsFamily;
+		}
+
 		return indices;
 	}
 
+	std::vector<const char*> getDeviceExtensions() {
+		if (options.headless) {
+			return {};
+		}
+
+		return deviceExtensions;
+	}
+
 	std::vector<const char*> getRequiredExtensions() {
-		uint32_t glfwExtensionCount = 0;
-		const char** glfwExtensions;
-		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		std::vector<const char*> extensions;
+
+		if (!options.headless) {
+			uint32_t glfwExtensionCount = 0;
+			const char** glfwExtensions;
+			glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-		std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+			extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		}
 
 		if (enableValidationLayers) {
 			extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -1434,6 +3229,24 @@ private:
 		return true;
 	}
 
+	// Returns the asset straight from the pack mapping when it is packed; loose
+	// files are read into storage, which must outlive the returned view.
+	AssetView loadAsset(const std::string& name, std::vector<char>& storage) {
+		AssetView view;
+		if (assetPack.find(name, view)) {
+			return view;
+		}
+
+		storage = readFile(name);
+		view.data = storage.data();
+		view.size = storage.size();
+		return view;
+	}
+
+	bool assetExists(const std::string& name) const {
+		return assetPack.contains(name) || std::ifstream(name).good();
+	}
+
 	static std::vector<char> readFile(const std::string& filename) {
 		std::ifstream file(filename, std::ios::ate | std::ios::binary);
 
@@ -1459,10 +3272,9 @@ private:
 	}
 };
 
-int main() {
-	HelloTriangleApplication app;
-
+int main(int argc, char** argv) {
 	try {
+		HelloTriangleApplication app(parseOptions(argc, argv));
 		app.run();
 	}
 	catch (const std::exception& e) {
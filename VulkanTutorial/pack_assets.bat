@@ -0,0 +1,2 @@
+pushd shaders && call compile.bat && popd
+..\x64\Release\AssetPackBuilder.exe assets.pack shaders\vert.spv shaders\vert_octahedral.spv shaders\frag.spv shaders\cull.spv textures\texture.jpg
@@ -0,0 +1,4 @@
+%VULKAN_SDK%\Bin\glslc.exe shader.vert -o vert.spv
+%VULKAN_SDK%\Bin\glslc.exe -DOCTAHEDRAL_NORMALS shader.vert -o vert_octahedral.spv
+%VULKAN_SDK%\Bin\glslc.exe shader.frag -o frag.spv
+%VULKAN_SDK%\Bin\glslc.exe cull.comp -o cull.spv
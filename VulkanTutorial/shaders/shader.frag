@@ -1,9 +1,18 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+layout(push_constant) uniform DrawConstants {
+    vec4 tint;
+    uint textureIndex;
+} draw;
 
 layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
 
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = vec4(fragColor, 1.0);
+    outColor = vec4(fragColor * texture(textures[draw.textureIndex], fragTexCoord).rgb, 1.0);
 }
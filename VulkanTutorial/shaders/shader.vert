@@ -1,17 +1,55 @@
 #version 450
 
 layout(binding = 0) uniform UniformBufferObject {
-    mat4 model;
     mat4 view;
     mat4 proj;
 } ubo;
 
-layout(location = 0) in vec2 inPosition;
-layout(location = 1) in vec3 inColor;
+layout(binding = 1) uniform ObjectUniforms {
+    mat4 model;
+} object;
+
+layout(push_constant) uniform DrawConstants {
+    vec4 tint;
+    uint textureIndex;
+} draw;
+
+layout(location = 0) in vec3 inPosition;
+#ifdef OCTAHEDRAL_NORMALS
+layout(location = 1) in vec2 inNormal;
+#else
+layout(location = 1) in vec3 inNormal;
+#endif
+layout(location = 2) in vec3 inColor;
+layout(location = 3) in mat4 inModel;
 
 layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+
+const vec3 LIGHT_DIRECTION = vec3(0.40824829, 0.40824829, 0.81649658);
+const float AMBIENT = 0.3;
+
+vec3 decodeOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 0.0, 1.0);
-    fragColor = inColor;
-}
\ No newline at end of file
+    mat4 model = object.model * inModel;
+    gl_Position = ubo.proj * ubo.view * model * vec4(inPosition, 1.0);
+
+#ifdef OCTAHEDRAL_NORMALS
+    vec3 normal = decodeOctahedral(inNormal);
+#else
+    vec3 normal = inNormal;
+#endif
+    normal = normalize(mat3(model) * normal);
+
+    // The mesh has no texture coordinates, so project the texture along z.
+    fragTexCoord = inPosition.xy + 0.5;
+
+    fragColor = inColor * draw.tint.rgb * (AMBIENT + (1.0 - AMBIENT) * max(dot(normal, LIGHT_DIRECTION), 0.0));
+}
@@ -0,0 +1,133 @@
+#include "MemoryAllocator.h"
+
+#include <iostream>
+#include <cstdlib>
+
+// CPU-only checks of the FreeList that backs every DeviceMemoryAllocator block,
+// so placement and coalescing can be verified without a Vulkan device.
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+			failures++; \
+		} \
+	} while (0)
+
+static VkDeviceSize allocateAt(FreeList& list, VkDeviceSize size, VkDeviceSize alignment) {
+	VkDeviceSize offset = ~0ull;
+	if (!list.allocate(size, alignment, offset)) {
+		std::cerr << "allocation of " << size << " bytes failed" << std::endl;
+		failures++;
+	}
+	return offset;
+}
+
+static void testAlignedPlacement() {
+	FreeList list(1024);
+
+	CHECK(allocateAt(list, 10, 1) == 0);
+
+	// Padding in front of an aligned allocation stays free.
+	VkDeviceSize offset = allocateAt(list, 16, 256);
+	CHECK(offset == 256);
+	CHECK(list.getFreeRangeCount() == 2);
+	CHECK(list.getFreeBytes() == 1024 - 10 - 16);
+
+	// The padding is still usable by a smaller alignment.
+	CHECK(allocateAt(list, 100, 4) == 12);
+}
+
+static void testBestFit() {
+	FreeList list(256);
+
+	VkDeviceSize a = allocateAt(list, 64, 1);
+	allocateAt(list, 32, 1);
+	VkDeviceSize c = allocateAt(list, 32, 1);
+	allocateAt(list, 32, 1);
+
+	// Holes of 64 at 0 and 32 at 96, plus the 96-byte tail at 160.
+	list.free(a, 64);
+	list.free(c, 32);
+
+	CHECK(allocateAt(list, 32, 1) == 96);
+	CHECK(allocateAt(list, 48, 1) == 0);
+}
+
+static void testCoalescing() {
+	FreeList list(256);
+
+	VkDeviceSize offsets[4];
+	for (VkDeviceSize& offset : offsets) {
+		offset = allocateAt(list, 64, 1);
+	}
+	CHECK(list.getFreeRangeCount() == 0);
+
+	// Freed out of order so both the previous and the next neighbour get merged.
+	list.free(offsets[0], 64);
+	list.free(offsets[2], 64);
+	CHECK(list.getFreeRangeCount() == 2);
+	list.free(offsets[1], 64);
+	CHECK(list.getFreeRangeCount() == 1);
+	list.free(offsets[3], 64);
+
+	CHECK(list.getFreeRangeCount() == 1);
+	CHECK(list.empty());
+	CHECK(list.largestFreeRange() == 256);
+}
+
+static void testFragmentation() {
+	FreeList list(256);
+
+	VkDeviceSize offsets[4];
+	for (VkDeviceSize& offset : offsets) {
+		offset = allocateAt(list, 64, 1);
+	}
+
+	list.free(offsets[0], 64);
+	list.free(offsets[2], 64);
+	CHECK(list.getFreeBytes() == 128);
+	CHECK(list.largestFreeRange() == 64);
+	CHECK(list.getFragmentedBytes() == 64);
+
+	// Enough bytes in total, but no single range is large enough.
+	VkDeviceSize offset;
+	CHECK(!list.allocate(128, 1, offset));
+
+	list.free(offsets[1], 64);
+	CHECK(list.getFragmentedBytes() == 0);
+	CHECK(allocateAt(list, 128, 1) == 0);
+}
+
+static void testExhaustion() {
+	FreeList list(128);
+
+	CHECK(allocateAt(list, 128, 1) == 0);
+	CHECK(list.getFreeRangeCount() == 0);
+
+	VkDeviceSize offset;
+	CHECK(!list.allocate(1, 1, offset));
+
+	// Alignment padding counts against the range it comes from.
+	list.reset(128);
+	allocateAt(list, 1, 1);
+	CHECK(!list.allocate(128 - 64, 128, offset));
+}
+
+int main() {
+	testAlignedPlacement();
+	testBestFit();
+	testCoalescing();
+	testFragmentation();
+	testExhaustion();
+
+	if (failures > 0) {
+		std::cerr << failures << " check(s) failed" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "FreeList: all checks passed" << std::endl;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+// Packs loose asset files into a single archive that VulkanTutorial maps at
+// startup. Entries are named by the path given on the command line, with
+// backslashes turned into slashes, so run it from the VulkanTutorial directory:
+//
+//   AssetPackBuilder assets.pack shaders/vert.spv shaders/vert_octahedral.spv shaders/frag.spv shaders/cull.spv textures/texture.jpg
+
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+
+#include "AssetPack.h"
+
+struct PackInput {
+	std::string name;
+	std::vector<char> data;
+};
+
+std::vector<char> readFile(const std::string& filename) {
+	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+	if (!file.is_open()) {
+		throw std::runtime_error("failed to open " + filename + "!");
+	}
+
+	size_t fileSize = (size_t)file.tellg();
+	std::vector<char> buffer(fileSize);
+
+	file.seekg(0);
+	file.read(buffer.data(), fileSize);
+
+	return buffer;
+}
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+int main(int argc, char** argv) {
+	try {
+		if (argc < 3) {
+			throw std::runtime_error("usage: AssetPackBuilder <output.pack> <file>...");
+		}
+
+		std::string output = argv[1];
+
+		std::vector<PackInput> inputs;
+		for (int i = 2; i < argc; i++) {
+			PackInput input;
+			input.name = argv[i];
+			std::replace(input.name.begin(), input.name.end(), '\\', '/');
+
+			if (input.name.size() >= ASSET_NAME_SIZE) {
+				throw std::runtime_error("asset name too long: " + input.name);
+			}
+
+			input.data = readFile(argv[i]);
+			inputs.push_back(std::move(input));
+		}
+
+		// The runtime binary searches the entry table, so it has to be sorted the
+		// same way strncmp orders names.
+		std::sort(inputs.begin(), inputs.end(), [](const PackInput& a, const PackInput& b) {
+			return strcmp(a.name.c_str(), b.name.c_str()) < 0;
+		});
+
+		for (size_t i = 1; i < inputs.size(); i++) {
+			if (inputs[i].name == inputs[i - 1].name) {
+				throw std::runtime_error("duplicate asset: " + inputs[i].name);
+			}
+		}
+
+		AssetPackHeader header{};
+		header.magic = ASSET_PACK_MAGIC;
+		header.version = ASSET_PACK_VERSION;
+		header.entryCount = static_cast<uint32_t>(inputs.size());
+
+		std::vector<AssetPackEntry> entries(inputs.size());
+		uint64_t offset = sizeof(header) + sizeof(AssetPackEntry) * entries.size();
+		for (size_t i = 0; i < inputs.size(); i++) {
+			memset(&entries[i], 0, sizeof(AssetPackEntry));
+			memcpy(entries[i].name, inputs[i].name.c_str(), inputs[i].name.size());
+
+			offset = alignUp(offset, ASSET_PACK_ALIGNMENT);
+			entries[i].offset = offset;
+			entries[i].size = inputs[i].data.size();
+			offset += inputs[i].data.size();
+		}
+
+		std::vector<char> pack(static_cast<size_t>(offset), 0);
+		memcpy(pack.data(), &header, sizeof(header));
+		memcpy(pack.data() + sizeof(header), entries.data(), sizeof(AssetPackEntry) * entries.size());
+		for (size_t i = 0; i < inputs.size(); i++) {
+			memcpy(pack.data() + entries[i].offset, inputs[i].data.data(), inputs[i].data.size());
+		}
+
+		std::ofstream file(output, std::ios::binary | std::ios::trunc);
+		if (!file.is_open() || !file.write(pack.data(), pack.size())) {
+			throw std::runtime_error("failed to write " + output + "!");
+		}
+
+		for (size_t i = 0; i < inputs.size(); i++) {
+			std::cout << "  " << entries[i].name << ": " << entries[i].size << " bytes at " << entries[i].offset << std::endl;
+		}
+		std::cout << output << ": " << inputs.size() << " assets, " << pack.size() << " bytes" << std::endl;
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,359 @@
+// Converts an image into a block-compressed KTX2 file with a full mip chain,
+// ready for VulkanTutorial to upload without decoding:
+//
+//   TextureConverter textures/texture.jpg textures/texture.ktx2 [--format bc1|bc3] [--linear]
+//
+// The encoder is a straightforward range fit: good enough for the tutorial's
+// assets, not a substitute for a production compressor.
+
+#include <vulkan/vulkan.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+
+#include "Mipmaps.h"
+#include "CompressedTexture.h"
+
+const uint32_t KTX2_COLOR_MODEL_BC1A = 128;
+const uint32_t KTX2_COLOR_MODEL_BC3 = 130;
+const uint32_t KTX2_PRIMARIES_BT709 = 1;
+const uint32_t KTX2_TRANSFER_LINEAR = 1;
+const uint32_t KTX2_TRANSFER_SRGB = 2;
+const uint32_t KTX2_CHANNEL_COLOR = 0;
+const uint32_t KTX2_CHANNEL_ALPHA = 15;
+const uint32_t KTX2_SAMPLE_LINEAR = 0x10;
+
+struct ConverterOptions {
+	std::string input;
+	std::string output;
+	bool bc3 = false;
+	bool linear = false;
+};
+
+ConverterOptions parseOptions(int argc, char** argv) {
+	ConverterOptions options;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+
+		if (arg == "--format") {
+			if (i + 1 >= argc) {
+				throw std::runtime_error("missing value for " + arg);
+			}
+			std::string format = argv[++i];
+			if (format != "bc1" && format != "bc3") {
+				throw std::runtime_error("unsupported format: " + format);
+			}
+			options.bc3 = format == "bc3";
+		}
+		else if (arg == "--linear") {
+			options.linear = true;
+		}
+		else if (options.input.empty()) {
+			options.input = arg;
+		}
+		else if (options.output.empty()) {
+			options.output = arg;
+		}
+		else {
+			throw std::runtime_error("unknown option: " + arg);
+		}
+	}
+
+	if (options.input.empty() || options.output.empty()) {
+		throw std::runtime_error("usage: TextureConverter <input> <output.ktx2> [--format bc1|bc3] [--linear]");
+	}
+
+	return options;
+}
+
+uint16_t packRGB565(const int color[3]) {
+	int r = (color[0] * 31 + 127) / 255;
+	int g = (color[1] * 63 + 127) / 255;
+	int b = (color[2] * 31 + 127) / 255;
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void unpackRGB565(uint16_t packed, int color[3]) {
+	int r = (packed >> 11) & 31;
+	int g = (packed >> 5) & 63;
+	int b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+// Copies the 4x4 block at (blockX, blockY), clamping at the right and bottom
+// edges so levels smaller than a block still encode.
+void fetchBlock(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, uint8_t block[16][4]) {
+	for (uint32_t y = 0; y < 4; y++) {
+		uint32_t sy = std::min(blockY * 4 + y, height - 1);
+		for (uint32_t x = 0; x < 4; x++) {
+			uint32_t sx = std::min(blockX * 4 + x, width - 1);
+			memcpy(block[y * 4 + x], pixels + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+		}
+	}
+}
+
+// Four-colour BC1 block: endpoints from the colour bounding box inset by 1/16,
+// then every texel picks its nearest palette entry.
+void encodeColorBlock(const uint8_t block[16][4], uint8_t* out) {
+	int minColor[3] = { 255, 255, 255 };
+	int maxColor[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < 3; c++) {
+			minColor[c] = std::min(minColor[c], static_cast<int>(block[i][c]));
+			maxColor[c] = std::max(maxColor[c], static_cast<int>(block[i][c]));
+		}
+	}
+
+	for (int c = 0; c < 3; c++) {
+		int inset = (maxColor[c] - minColor[c]) / 16;
+		minColor[c] += inset;
+		maxColor[c] -= inset;
+	}
+
+	uint16_t color0 = packRGB565(maxColor);
+	uint16_t color1 = packRGB565(minColor);
+	if (color0 < color1) {
+		std::swap(color0, color1);
+	}
+
+	int palette[4][3];
+	unpackRGB565(color0, palette[0]);
+	unpackRGB565(color1, palette[1]);
+	for (int c = 0; c < 3; c++) {
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	uint32_t indices = 0;
+	if (color0 != color1) {
+		for (int i = 0; i < 16; i++) {
+			int best = 0;
+			int bestError = INT32_MAX;
+			for (int p = 0; p < 4; p++) {
+				int error = 0;
+				for (int c = 0; c < 3; c++) {
+					int d = static_cast<int>(block[i][c]) - palette[p][c];
+					error += d * d;
+				}
+				if (error < bestError) {
+					best = p;
+					bestError = error;
+				}
+			}
+			indices |= static_cast<uint32_t>(best) << (i * 2);
+		}
+	}
+
+	memcpy(out, &color0, 2);
+	memcpy(out + 2, &color1, 2);
+	memcpy(out + 4, &indices, 4);
+}
+
+// Eight-value BC3 alpha block spanning the block's alpha range.
+void encodeAlphaBlock(const uint8_t block[16][4], uint8_t* out) {
+	int minAlpha = 255;
+	int maxAlpha = 0;
+	for (int i = 0; i < 16; i++) {
+		minAlpha = std::min(minAlpha, static_cast<int>(block[i][3]));
+		maxAlpha = std::max(maxAlpha, static_cast<int>(block[i][3]));
+	}
+
+	out[0] = static_cast<uint8_t>(maxAlpha);
+	out[1] = static_cast<uint8_t>(minAlpha);
+
+	int palette[8];
+	palette[0] = maxAlpha;
+	palette[1] = minAlpha;
+	for (int p = 1; p < 7; p++) {
+		palette[p + 1] = ((7 - p) * maxAlpha + p * minAlpha) / 7;
+	}
+
+	uint64_t indices = 0;
+	if (maxAlpha != minAlpha) {
+		for (int i = 0; i < 16; i++) {
+			int best = 0;
+			int bestError = INT32_MAX;
+			for (int p = 0; p < 8; p++) {
+				int error = std::abs(static_cast<int>(block[i][3]) - palette[p]);
+				if (error < bestError) {
+					best = p;
+					bestError = error;
+				}
+			}
+			indices |= static_cast<uint64_t>(best) << (i * 3);
+		}
+	}
+
+	for (int i = 0; i < 6; i++) {
+		out[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+	}
+}
+
+std::vector<char> compressLevel(const uint8_t* pixels, uint32_t width, uint32_t height, VkFormat format) {
+	uint32_t blocksX = (width + 3) / 4;
+	uint32_t blocksY = (height + 3) / 4;
+	uint32_t blockSize = getBlockSize(format);
+
+	std::vector<char> data(static_cast<size_t>(blocksX) * blocksY * blockSize);
+	uint8_t block[16][4];
+
+	for (uint32_t by = 0; by < blocksY; by++) {
+		for (uint32_t bx = 0; bx < blocksX; bx++) {
+			uint8_t* out = reinterpret_cast<uint8_t*>(data.data()) + (static_cast<size_t>(by) * blocksX + bx) * blockSize;
+			fetchBlock(pixels, width, height, bx, by, block);
+
+			if (blockSize == 16) {
+				encodeAlphaBlock(block, out);
+				out += 8;
+			}
+			encodeColorBlock(block, out);
+		}
+	}
+
+	return data;
+}
+
+void appendUint32(std::vector<char>& data, uint32_t value) {
+	data.insert(data.end(), reinterpret_cast<const char*>(&value), reinterpret_cast<const char*>(&value) + sizeof(value));
+}
+
+// Basic data format descriptor (Khronos DFD) for a BC1 or BC3 texture.
+std::vector<char> createDataFormatDescriptor(VkFormat format, bool linear) {
+	bool bc3 = format == VK_FORMAT_BC3_UNORM_BLOCK || format == VK_FORMAT_BC3_SRGB_BLOCK;
+	uint32_t sampleCount = bc3 ? 2 : 1;
+	uint32_t blockSize = 24 + 16 * sampleCount;
+
+	std::vector<char> dfd;
+	appendUint32(dfd, 4 + blockSize);
+	appendUint32(dfd, 0); // vendor 0 (Khronos), descriptor type 0 (basic)
+	appendUint32(dfd, 2 | (blockSize << 16)); // version 2
+	appendUint32(dfd, (bc3 ? KTX2_COLOR_MODEL_BC3 : KTX2_COLOR_MODEL_BC1A) | (KTX2_PRIMARIES_BT709 << 8) |
+		((linear ? KTX2_TRANSFER_LINEAR : KTX2_TRANSFER_SRGB) << 16));
+	appendUint32(dfd, 3 | (3 << 8)); // 4x4 texel block
+	appendUint32(dfd, getBlockSize(format)); // bytesPlane0
+	appendUint32(dfd, 0);
+
+	if (bc3) {
+		uint32_t alphaChannel = KTX2_CHANNEL_ALPHA | (linear ? 0 : KTX2_SAMPLE_LINEAR);
+		appendUint32(dfd, 0 | (63 << 16) | (alphaChannel << 24));
+		appendUint32(dfd, 0);
+		appendUint32(dfd, 0);
+		appendUint32(dfd, UINT32_MAX);
+	}
+
+	appendUint32(dfd, (bc3 ? 64 : 0) | (63 << 16) | (KTX2_CHANNEL_COLOR << 24));
+	appendUint32(dfd, 0);
+	appendUint32(dfd, 0);
+	appendUint32(dfd, UINT32_MAX);
+
+	return dfd;
+}
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+void writeKtx2(const std::string& filename, VkFormat format, uint32_t width, uint32_t height, bool linear, const std::vector<std::vector<char>>& levels) {
+	uint32_t levelCount = static_cast<uint32_t>(levels.size());
+	std::vector<char> dfd = createDataFormatDescriptor(format, linear);
+
+	Ktx2Header header{};
+	memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+	header.vkFormat = format;
+	header.typeSize = 1;
+	header.pixelWidth = width;
+	header.pixelHeight = height;
+	header.faceCount = 1;
+	header.levelCount = levelCount;
+	header.dfdByteOffset = static_cast<uint32_t>(sizeof(header) + sizeof(Ktx2LevelIndex) * levelCount);
+	header.dfdByteLength = static_cast<uint32_t>(dfd.size());
+
+	// Level data follows the DFD smallest level first, each aligned to the
+	// block size as the spec requires.
+	std::vector<Ktx2LevelIndex> levelIndex(levelCount);
+	VkDeviceSize offset = header.dfdByteOffset + header.dfdByteLength;
+	for (uint32_t level = levelCount; level-- > 0;) {
+		offset = alignUp(offset, getBlockSize(format));
+		levelIndex[level].byteOffset = offset;
+		levelIndex[level].byteLength = levels[level].size();
+		levelIndex[level].uncompressedByteLength = levels[level].size();
+		offset += levels[level].size();
+	}
+
+	std::vector<char> file(static_cast<size_t>(offset), 0);
+	memcpy(file.data(), &header, sizeof(header));
+	memcpy(file.data() + sizeof(header), levelIndex.data(), sizeof(Ktx2LevelIndex) * levelCount);
+	memcpy(file.data() + header.dfdByteOffset, dfd.data(), dfd.size());
+	for (uint32_t level = 0; level < levelCount; level++) {
+		memcpy(file.data() + levelIndex[level].byteOffset, levels[level].data(), levels[level].size());
+	}
+
+	std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+	if (!out.is_open() || !out.write(file.data(), file.size())) {
+		throw std::runtime_error("failed to write " + filename + "!");
+	}
+}
+
+int main(int argc, char** argv) {
+	try {
+		ConverterOptions options = parseOptions(argc, argv);
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		int texWidth, texHeight, texChannels;
+		stbi_uc* pixels = stbi_load(options.input.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+		if (!pixels) {
+			throw std::runtime_error("failed to load " + options.input + "!");
+		}
+
+		uint32_t width = static_cast<uint32_t>(texWidth);
+		uint32_t height = static_cast<uint32_t>(texHeight);
+		std::vector<std::vector<uint8_t>> mipChain = generateMipChain(pixels, width, height);
+		stbi_image_free(pixels);
+
+		VkFormat format;
+		if (options.bc3) {
+			format = options.linear ? VK_FORMAT_BC3_UNORM_BLOCK : VK_FORMAT_BC3_SRGB_BLOCK;
+		}
+		else {
+			format = options.linear ? VK_FORMAT_BC1_RGBA_UNORM_BLOCK : VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+		}
+
+		std::vector<std::vector<char>> levels;
+		size_t uncompressedSize = 0;
+		size_t compressedSize = 0;
+		for (uint32_t level = 0; level < mipChain.size(); level++) {
+			levels.push_back(compressLevel(mipChain[level].data(), mipExtent(width, level), mipExtent(height, level), format));
+			uncompressedSize += mipChain[level].size();
+			compressedSize += levels.back().size();
+		}
+
+		writeKtx2(options.output, format, width, height, options.linear, levels);
+
+		auto endTime = std::chrono::high_resolution_clock::now();
+		float convertMs = std::chrono::duration<float, std::chrono::milliseconds::period>(endTime - startTime).count();
+
+		std::cout << options.output << ": " << width << "x" << height << ", " << levels.size() << " levels, "
+			<< uncompressedSize / 1024 << " KiB -> " << compressedSize / 1024 << " KiB in " << convertMs << " ms" << std::endl;
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}